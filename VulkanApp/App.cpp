@@ -1,42 +1,198 @@
 #include "App.h"
+#include "MeshConverter.h"
+#include "MeshOptimizer.h"
 
 #include <vector>
 #include <map>
 #include <set>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <cmath>
 
 namespace core
 {
-	void App::run()
+	void App::run(const Settings& settings)
 	{
-		initWindow();
+		_startTime = std::chrono::steady_clock::now();
+
+		_settings = settings;
+		_settings.framesInFlight = std::max(_settings.framesInFlight, 1u);
+		_jobSystem.init(_settings.workerCount());
+		_vertexInput = vertexInputDescription(_settings);
+
+		if (_settings.gpuDriven && _settings.clusterCulling) {
+			LOG(LogWarning, "cluster culling does not combine with GPU-driven objects, only objects are culled")
+			_settings.clusterCulling = false;
+		}
+
+		if (_settings.clusterCulling && _settings.drawCount > 1)
+			LOG(LogWarning, "cluster culling draws the meshlets of the first object only")
+
+		if (_settings.cpuCulling && (_settings.gpuDriven || _settings.clusterCulling)) {
+			LOG(LogWarning, "CPU culling only applies to objects drawn one by one, it is turned off")
+			_settings.cpuCulling = false;
+		}
+
+		if (_settings.readback && !_settings.headless) {
+			LOG(LogWarning, "frame readback is only available in headless mode")
+			_settings.readback = false;
+		}
+
+		// startup runs as a dependency graph on the job system: file I/O first, device
+		// independent objects and shader modules next to the swapchain chain
+		loadShaderCode();
+		if (!_settings.headless)
+			runStage("initWindow", [this] { initWindow(); });
 		initVulkan();
 		loop();
 		clean();
 	}
 
+	void App::runStage(const char* name, const std::function<void()>& function)
+	{
+		PROFILE_ZONE(name)
+
+		const auto begin = std::chrono::steady_clock::now();
+		function();
+		const auto end = std::chrono::steady_clock::now();
+
+		const std::chrono::duration<double, std::milli> start = begin - _startTime;
+		const std::chrono::duration<double, std::milli> duration = end - begin;
+
+		std::lock_guard<std::mutex> lock(_startupMutex);
+		_startupStages.push_back({ name, _jobSystem.threadIndex(), start.count(), duration.count() });
+	}
+
+	util::JobSystem::Task App::asyncStage(const char* name, const std::function<void()>& function)
+	{
+		return [this, name, function] {
+			{
+				// a stage whose inputs failed is skipped, the first error is rethrown on the main thread
+				std::lock_guard<std::mutex> lock(_startupMutex);
+				if (_startupError)
+					return;
+			}
+
+			try {
+				runStage(name, function);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(_startupMutex);
+				if (!_startupError)
+					_startupError = std::current_exception();
+			}
+		};
+	}
+
+	void App::rethrowStartupError()
+	{
+		std::lock_guard<std::mutex> lock(_startupMutex);
+		if (_startupError)
+			std::rethrow_exception(_startupError);
+	}
+
+	void App::logStartup()
+	{
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - _startTime;
+		REPORT("first frame submitted " << elapsed.count() << "ms after startup")
+
+		std::lock_guard<std::mutex> lock(_startupMutex);
+		std::sort(_startupStages.begin(), _startupStages.end(), [](const StartupStage& a, const StartupStage& b) {
+			return a.start < b.start;
+		});
+
+		for (const auto& stage : _startupStages)
+			REPORT(util::Log::tab << stage.name << ": thread " << stage.thread << ", +" << stage.start
+				<< "ms, " << stage.duration << "ms")
+
+		const util::JobSystem::Stats jobStats = _jobSystem.stats();
+		REPORT("job system: " << jobStats.executed << " tasks executed on " << _jobSystem.threadCount() << " threads, "
+			<< jobStats.stolen << " stolen")
+	}
+
+	void App::loadShaderCode()
+	{
+		_jobSystem.run(asyncStage("read vert.spv", [this] { _vertShaderCode = readFile("../vert.spv"); }), &_shaderCodeLoaded);
+		_jobSystem.run(asyncStage("read frag.spv", [this] { _fragShaderCode = readFile("../frag.spv"); }), &_shaderCodeLoaded);
+		if (_settings.clusterCulling)
+			_jobSystem.run(asyncStage("read cluster.spv", [this] { _cullShaderCode = readFile("../cluster.spv"); }), &_shaderCodeLoaded);
+		if (_settings.gpuDriven)
+			_jobSystem.run(asyncStage("read objects.spv", [this] { _objectCullShaderCode = readFile("../objects.spv"); }), &_shaderCodeLoaded);
+	}
+
 
 	void App::initWindow()
 	{
 		glfwInit();
 		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-		_window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
+		_window = glfwCreateWindow(_settings.width, _settings.height, "Vulkan", nullptr, nullptr);
 	}
 
 	void App::initVulkan()
 	{
-		createInstance();
-		createSurface();
-		pickPhysicalDevice();
-		createLogicalDevice();
-		createSwapChain();
-		createImageViews();
-		createRenderPass();
-		createGraphicsPipeline();
-		createFramebuffers();
-		createCommandPool();
-		createCommandBuffers();
-		createSemaphores();
+		runStage("createInstance", [this] { createInstance(); });
+		if (!_settings.headless)
+			runStage("createSurface", [this] { createSurface(); });
+		runStage("pickPhysicalDevice", [this] { pickPhysicalDevice(); });
+		runStage("createLogicalDevice", [this] { createLogicalDevice(); });
+		_memoryAllocator.init(_physicalDevice, _device);
+
+		// everything below only needs the device, the surface is no longer queried
+		util::JobSystem::Counter pipelineInputs;
+		_jobSystem.runAfter(_shaderCodeLoaded, asyncStage("createShaderModules", [this] { createShaderModules(); }), &pipelineInputs);
+		_jobSystem.run(asyncStage("loadPipelineCache", [this] {
+			_pipelineCache.init(_physicalDevice, _device, _settings.pipelineCachePath);
+		}), &pipelineInputs);
+
+		util::JobSystem::Counter independent;
+		_jobSystem.run(asyncStage("createCommandBuffers", [this] {
+			createCommandPools();
+			createCommandBuffers();
+		}), &independent);
+		util::JobSystem::Counter uploadsCreated;
+		_jobSystem.run(asyncStage("createUploads", [this] { createUploads(); }), &uploadsCreated);
+		_jobSystem.runAfter(uploadsCreated, asyncStage("createMesh", [this] { createMesh(); }), &independent);
+
+		if (_settings.headless)
+			runStage("createOffscreenTargets", [this] { createOffscreenTargets(); });
+		else
+			runStage("createSwapChain", [this] { createSwapChain(); });
+
+		if (_swapChainOwnershipTransfer)
+			_jobSystem.run(asyncStage("createPresentCommandBuffers", [this] { createPresentCommandBuffers(); }), &independent);
+
+		_jobSystem.run(asyncStage("createSyncObjects", [this] { createSyncObjects(); }), &independent);
+		_jobSystem.run(asyncStage("createGpuProfiler", [this] {
+			_gpuProfiler.init(_physicalDevice, _device, _queueFamilyIndices.graphicsFamily, _settings.framesInFlight);
+		}), &independent);
+		if (_settings.readback)
+			_jobSystem.run(asyncStage("createReadback", [this] { createReadback(); }), &independent);
+
+		runStage("createImageViews", [this] { createImageViews(); });
+		runStage("createRenderPass", [this] { createRenderPass(); });
+
+		_jobSystem.wait(pipelineInputs);
+		rethrowStartupError();
+
+		util::JobSystem::Counter pipelines;
+		_jobSystem.run(asyncStage("createGraphicsPipeline", [this] { createGraphicsPipeline(); }), &pipelines);
+		runStage("createFramebuffers", [this] { createFramebuffers(); });
+
+		_jobSystem.wait(pipelines);
+		_jobSystem.wait(independent);
+		rethrowStartupError();
+
+		// need the mesh's meshlets or objects and the pipeline cache
+		if (_settings.clusterCulling)
+			runStage("createClusterCuller", [this] { createClusterCuller(); });
+		if (_settings.gpuDriven)
+			runStage("createObjectCuller", [this] { createObjectCuller(); });
+		// needs the pipeline and the objects, objects drawn one by one go through the render queue
+		runStage("createRenderQueue", [this] { createRenderQueue(); });
 	}
 
 	void App::createInstance()
@@ -53,9 +209,10 @@ namespace core
 		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 		createInfo.pApplicationInfo = &appInfo;
 
-		uint glfwExtensionCount;
-		const char** glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		uint glfwExtensionCount = 0;
+		const char** glfwExtensions = nullptr;
+		if (!_settings.headless)
+			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
 		createInfo.enabledExtensionCount = glfwExtensionCount;
 		createInfo.ppEnabledExtensionNames = glfwExtensions;
@@ -106,7 +263,7 @@ namespace core
 		std::vector<VkPhysicalDevice> devices(deviceCount);
 		vkEnumeratePhysicalDevices(_vkInstance, &deviceCount, devices.data());
 
-		const auto rateDevice = [](VkPhysicalDevice device) -> uint {
+		const auto rateDevice = [this](VkPhysicalDevice device) -> uint {
 			uint score = 0;
 
 			VkPhysicalDeviceProperties deviceProperties;
@@ -119,7 +276,7 @@ namespace core
 
 			score += deviceProperties.limits.maxImageDimension2D;
 
-			if (!deviceFeatures.geometryShader)
+			if (!deviceFeatures.geometryShader && !_settings.headless)
 				return 0;
 
 			LOG(LogInfo, "rating " << score << util::Log::tab << deviceProperties.deviceName)
@@ -140,12 +297,21 @@ namespace core
 
 	void App::createLogicalDevice()
 	{
-		QueueFamilyIndices indices = findQueueFamilies(_physicalDevice);
+		_queueFamilyIndices = findQueueFamilies(_physicalDevice);
+		const QueueFamilyIndices& indices = _queueFamilyIndices;
+
+		// uploads take one queue of the transfer family, or else of the compute family since it can copy as
+		// well. The other queues of these families are left alone until something submits to them
+		int uploadFamily = -1;
+		if (_settings.transferQueue)
+			uploadFamily = indices.transferFamily >= 0 ? indices.transferFamily : indices.computeFamily;
 
-		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 		std::set<int> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
-		
-		float queuePriority = 1.f;
+		if (uploadFamily >= 0)
+			uniqueQueueFamilies.insert(uploadFamily);
+
+		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+		const float queuePriority = 1.f;
 		for (int queueFamily : uniqueQueueFamilies) {
 			VkDeviceQueueCreateInfo queueCreateInfo = {};
 			queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
@@ -155,7 +321,26 @@ namespace core
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+		_multiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+
+		// GPU-driven draws pass the object in firstInstance
+		if (_settings.gpuDriven && !supportedFeatures.drawIndirectFirstInstance) {
+			LOG(LogWarning, "drawIndirectFirstInstance is not supported, objects are drawn from the CPU")
+			_settings.gpuDriven = false;
+		}
+
+		std::vector<const char*> extensions;
+		if (!_settings.headless)
+			extensions.assign(deviceExtensions.begin(), deviceExtensions.end());
+		const bool drawIndirectCount = _settings.gpuDriven && hasDeviceExtension(_physicalDevice, VK_AMD_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		if (drawIndirectCount)
+			extensions.push_back(VK_AMD_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
 		VkPhysicalDeviceFeatures deviceFeatures = {};
+		deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+		deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
 		VkDeviceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
@@ -164,15 +349,29 @@ namespace core
 
 		createInfo.pEnabledFeatures = &deviceFeatures;
 		createInfo.enabledLayerCount = 0;
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+		createInfo.ppEnabledExtensionNames = extensions.data();
 
 		VkResult result = vkCreateDevice(_physicalDevice, &createInfo, nullptr, &_device);
 		if (result != VK_SUCCESS)
 			THROW("failed to create logical device with error :" + result)
 
+		if (drawIndirectCount)
+			_drawIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountAMD>(
+				vkGetDeviceProcAddr(_device, "vkCmdDrawIndexedIndirectCountAMD"));
+
 		vkGetDeviceQueue(_device, indices.graphicsFamily, 0, &_graphicsQueue);
 		vkGetDeviceQueue(_device, indices.presentFamily, 0, &_presentQueue);
+
+		if (uploadFamily >= 0) {
+			_uploadFamily = uploadFamily;
+			vkGetDeviceQueue(_device, _uploadFamily, 0, &_uploadQueue);
+		}
+
+		LOG(LogInfo, "queues: graphics family " << indices.graphicsFamily << ", present family " << indices.presentFamily
+			<< ", compute family " << indices.computeFamily << " (" << indices.computeQueueCount << " queues), transfer family "
+			<< indices.transferFamily << " (" << indices.transferQueueCount << " queues), uploads on "
+			<< (_uploadQueue != VK_NULL_HANDLE ? "family " + std::to_string(_uploadFamily) : std::string("the graphics queue")))
 	}
 
 	void App::createSwapChain()
@@ -197,9 +396,15 @@ namespace core
 		createInfo.imageArrayLayers = 1;
 		createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-		QueueFamilyIndices indices = findQueueFamilies(_physicalDevice);
+		const QueueFamilyIndices& indices = _queueFamilyIndices;
 		uint32_t queueFamilyIndices[] = { (uint32_t)indices.graphicsFamily, (uint32_t)indices.presentFamily };
-		if (indices.graphicsFamily != indices.presentFamily) {
+
+		// concurrent sharing can disable framebuffer compression, exclusive images need explicit ownership transfers instead
+		_swapChainOwnershipTransfer = indices.graphicsFamily != indices.presentFamily && _settings.exclusiveSwapchain;
+		if (_settings.exclusiveSwapchain && !_swapChainOwnershipTransfer)
+			LOG(LogInfo, "graphics and present families are the same, swapchain images are exclusive already")
+
+		if (indices.graphicsFamily != indices.presentFamily && !_swapChainOwnershipTransfer) {
 			createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
 			createInfo.queueFamilyIndexCount = 2;
 			createInfo.pQueueFamilyIndices = queueFamilyIndices;
@@ -225,6 +430,100 @@ namespace core
 
 		_swapChainImageFormat = surfaceFormat.format;
 		_swapChainExtent = extent;
+
+		LOG(LogInfo, "swapchain: " << imageCount << " images, " << (createInfo.imageSharingMode == VK_SHARING_MODE_EXCLUSIVE ? "exclusive" : "concurrent")
+			<< " sharing" << (_swapChainOwnershipTransfer ? " with ownership transfers to the present family" : ""))
+	}
+
+	void App::createPresentCommandBuffers()
+	{
+		const QueueFamilyIndices& queueFamilyIndices = _queueFamilyIndices;
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = queueFamilyIndices.presentFamily;
+
+		VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &_presentCommandPool);
+		if (result != VK_SUCCESS)
+			THROW("failed to create present command pool with error: " + std::to_string(result))
+
+		_presentCommandBuffers.resize(_swapChainImages.size());
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = _presentCommandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = static_cast<uint32_t>(_presentCommandBuffers.size());
+
+		result = vkAllocateCommandBuffers(_device, &allocInfo, _presentCommandBuffers.data());
+		if (result != VK_SUCCESS)
+			THROW("failed to allocate present command buffers with error: " + std::to_string(result))
+
+		// the acquire half of the transfer recordCommandBuffer releases, it never changes so it is recorded once
+		for (size_t i = 0; i < _presentCommandBuffers.size(); ++i) {
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+
+			vkBeginCommandBuffer(_presentCommandBuffers[i], &beginInfo);
+
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = 0;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+			barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+			barrier.srcQueueFamilyIndex = queueFamilyIndices.graphicsFamily;
+			barrier.dstQueueFamilyIndex = queueFamilyIndices.presentFamily;
+			barrier.image = _swapChainImages[i];
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+			vkCmdPipelineBarrier(_presentCommandBuffers[i], VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+				0, nullptr, 0, nullptr, 1, &barrier);
+
+			result = vkEndCommandBuffer(_presentCommandBuffers[i]);
+			if (result != VK_SUCCESS)
+				THROW("failed to record present command buffer with error: " + std::to_string(result))
+		}
+
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		_presentReadySemaphores.resize(_settings.framesInFlight);
+		for (auto& semaphore : _presentReadySemaphores) {
+			result = vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &semaphore);
+			if (result != VK_SUCCESS)
+				THROW("failed to create semaphore with error: " + std::to_string(result))
+		}
+	}
+
+	void App::createOffscreenTargets()
+	{
+		_swapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+		_swapChainExtent = { _settings.width, _settings.height };
+
+		_swapChainImages.resize(_settings.framesInFlight);
+		_offscreenImageAllocations.resize(_settings.framesInFlight);
+		for (size_t i = 0; i < _swapChainImages.size(); ++i) {
+			VkImageCreateInfo imageInfo = {};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.format = _swapChainImageFormat;
+			imageInfo.extent = { _swapChainExtent.width, _swapChainExtent.height, 1 };
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			VkResult result = vkCreateImage(_device, &imageInfo, nullptr, &_swapChainImages[i]);
+			if (result != VK_SUCCESS)
+				THROW("failed to create offscreen image with error: " + std::to_string(result))
+
+			_offscreenImageAllocations[i] = _memoryAllocator.bind(_swapChainImages[i], imageInfo.tiling, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		}
 	}
 
 	void App::createImageViews()
@@ -264,7 +563,7 @@ namespace core
 		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		colorAttachment.finalLayout = _settings.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 		VkAttachmentReference colorAttachmentRef = {};
 		colorAttachmentRef.attachment = 0;
@@ -283,14 +582,28 @@ namespace core
 		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
+		// offscreen targets are read back by transfers submitted after the render pass
+		VkSubpassDependency readbackDependency = {};
+		readbackDependency.srcSubpass = 0;
+		readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+		readbackDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		readbackDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		readbackDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		readbackDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		if (_settings.headless)
+			dependency.srcStageMask |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		VkSubpassDependency dependencies[] = { dependency, readbackDependency };
+
 		VkRenderPassCreateInfo renderPassInfo = {};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 		renderPassInfo.attachmentCount = 1;
 		renderPassInfo.pAttachments = &colorAttachment;
 		renderPassInfo.subpassCount = 1;
 		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 1;
-		renderPassInfo.pDependencies = &dependency;
+		renderPassInfo.dependencyCount = _settings.headless ? 2 : 1;
+		renderPassInfo.pDependencies = dependencies;
 
 		VkResult result = vkCreateRenderPass(_device, &renderPassInfo, nullptr, &_renderPass);
 		if (result != VK_SUCCESS)
@@ -298,34 +611,44 @@ namespace core
 
 	}
 
-	void App::createGraphicsPipeline()
+	void App::createShaderModules()
 	{
-		auto vertShaderCode = readFile("../vert.spv");
-		auto fragShaderCode = readFile("../frag.spv");
+		_vertShaderModule = createShaderModule(_vertShaderCode);
+		_fragShaderModule = createShaderModule(_fragShaderCode);
 
-		VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-		VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+		_vertShaderCode.clear();
+		_fragShaderCode.clear();
+	}
 
+	void App::createGraphicsPipeline()
+	{
 		VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
 		vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-		vertShaderStageInfo.module = vertShaderModule;
+		vertShaderStageInfo.module = _vertShaderModule;
 		vertShaderStageInfo.pName = "main";
 
 		VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
 		fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		fragShaderStageInfo.module = fragShaderModule;
+		fragShaderStageInfo.module = _fragShaderModule;
 		fragShaderStageInfo.pName = "main";
 
 		VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vertexInputInfo.vertexBindingDescriptionCount = 0;
-		vertexInputInfo.pVertexBindingDescriptions = nullptr;
-		vertexInputInfo.vertexAttributeDescriptionCount = 0;
-		vertexInputInfo.pVertexAttributeDescriptions = nullptr;
+		// the mesh's streams, then the objects' transforms per instance
+		std::vector<VkVertexInputBindingDescription> bindings = _vertexInput.bindings;
+		std::vector<VkVertexInputAttributeDescription> attributes = _vertexInput.attributes;
+		bindings.push_back({ static_cast<uint32_t>(bindings.size()), sizeof(DrawObject), VK_VERTEX_INPUT_RATE_INSTANCE });
+		attributes.push_back({ static_cast<uint32_t>(attributes.size()), bindings.back().binding, VK_FORMAT_R32G32B32A32_SFLOAT,
+			offsetof(DrawObject, transform) });
+
+		vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+		vertexInputInfo.pVertexBindingDescriptions = bindings.data();
+		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+		vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
 
 		VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
 		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -436,12 +759,18 @@ namespace core
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 		pipelineInfo.basePipelineIndex = -1;
 
-		result = vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_graphicsPipeline);
+		const auto start = std::chrono::steady_clock::now();
+
+		result = vkCreateGraphicsPipelines(_device, _pipelineCache.handle(), 1, &pipelineInfo, nullptr, &_graphicsPipeline);
 		if(result != VK_SUCCESS)
 			THROW("failed to create graphics pipeline with error: " + result)
 
-		vkDestroyShaderModule(_device, fragShaderModule, nullptr);
-		vkDestroyShaderModule(_device, vertShaderModule, nullptr);
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		REPORT("graphics pipeline created in " << elapsed.count() << "ms ("
+			<< (_pipelineCache.warm() ? "warm" : "cold") << " pipeline cache)")
+
+		vkDestroyShaderModule(_device, _fragShaderModule, nullptr);
+		vkDestroyShaderModule(_device, _vertShaderModule, nullptr);
 	}
 
 	void App::createFramebuffers()
@@ -467,77 +796,597 @@ namespace core
 		}
 	}
 
-	void App::createCommandPool()
+	void App::createCommandPools()
 	{
-		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(_physicalDevice);
+		const QueueFamilyIndices& queueFamilyIndices = _queueFamilyIndices;
 
 		VkCommandPoolCreateInfo poolInfo = {};
 		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 		poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
-		poolInfo.flags = 0;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
-		VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &_commandPool);
-		if(result != VK_SUCCESS)
-			THROW("failed to create command pool with error: " + result)
+		_commandPools.resize(_settings.framesInFlight);
+		for (auto& commandPool : _commandPools) {
+			VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &commandPool);
+			if(result != VK_SUCCESS)
+				THROW("failed to create command pool with error: " + std::to_string(result))
+		}
 	}
 
 	void App::createCommandBuffers()
 	{
-		_commandBuffers.resize(_swapChainFramebuffers.size());
+		_commandBuffers.resize(_settings.framesInFlight);
 
-		VkCommandBufferAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.commandPool = _commandPool;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandBufferCount = static_cast<uint32_t>(_commandBuffers.size());
+		for (size_t i = 0; i < _commandBuffers.size(); ++i) {
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = _commandPools[i];
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
 
-		VkResult result = vkAllocateCommandBuffers(_device, &allocInfo, _commandBuffers.data());
-		if(result != VK_SUCCESS)
-			THROW("failed to allocate command buffers with error: " + result)
+			VkResult result = vkAllocateCommandBuffers(_device, &allocInfo, &_commandBuffers[i]);
+			if(result != VK_SUCCESS)
+				THROW("failed to allocate command buffers with error: " + std::to_string(result))
+		}
 
-		for (size_t i = 0; i < _commandBuffers.size(); ++i) {
-			VkCommandBufferBeginInfo beginInfo = {};
-			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-			beginInfo.pInheritanceInfo = nullptr;
+		const QueueFamilyIndices& queueFamilyIndices = _queueFamilyIndices;
+		_commandRecorder.init(_device, queueFamilyIndices.graphicsFamily, _jobSystem, _settings.framesInFlight);
+	}
 
-			vkBeginCommandBuffer(_commandBuffers[i], &beginInfo);
+	void App::recordCommandBuffer(uint32_t imageIndex)
+	{
+		PROFILE_ZONE("record")
 
-			VkRenderPassBeginInfo renderPassInfo = {};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassInfo.renderPass = _renderPass;
-			renderPassInfo.framebuffer = _swapChainFramebuffers[i];
-			renderPassInfo.renderArea.offset = { 0, 0 };
-			renderPassInfo.renderArea.extent = _swapChainExtent;
+		const auto start = std::chrono::steady_clock::now();
 
-			VkClearValue clearColor = { 0.15f, 0.15f, 0.15f, 1.f };
-			renderPassInfo.clearValueCount = 1;
-			renderPassInfo.pClearValues = &clearColor;
+		// the frame's fence has signaled, everything allocated from its pools can be recycled at once
+		vkResetCommandPool(_device, _commandPools[_currentFrame], 0);
+		_commandRecorder.reset(static_cast<uint32_t>(_currentFrame));
+		_uploads.retire(static_cast<uint32_t>(_currentFrame));
+		streamUploads();
 
-			vkCmdBeginRenderPass(_commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-			vkCmdBindPipeline(_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
-			vkCmdDraw(_commandBuffers[i], 3, 1, 0, 0);
-			vkCmdEndRenderPass(_commandBuffers[i]);
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = nullptr;
 
-			result = vkEndCommandBuffer(_commandBuffers[i]);
-			if(result != VK_SUCCESS)
-				THROW("failed to record command buffer with error: " + result)
+		// the upload queue's work of this slot is covered by the frame's fence too, the frame waits on it
+		if (_uploadQueue != VK_NULL_HANDLE) {
+			vkResetCommandPool(_device, _uploadCommandPools[_currentFrame], 0);
+
+			VkCommandBuffer uploadCommandBuffer = _uploadCommandBuffers[_currentFrame];
+			vkBeginCommandBuffer(uploadCommandBuffer, &beginInfo);
+			_uploadsPending = _uploads.flush(uploadCommandBuffer, static_cast<uint32_t>(_currentFrame));
+
+			VkResult result = vkEndCommandBuffer(uploadCommandBuffer);
+			if (result != VK_SUCCESS)
+				THROW("failed to record upload command buffer with error: " + std::to_string(result))
+		}
+
+		VkCommandBuffer commandBuffer = _commandBuffers[_currentFrame];
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		_gpuProfiler.beginFrame(commandBuffer, static_cast<uint32_t>(_currentFrame));
+
+		if (_uploadQueue != VK_NULL_HANDLE)
+			_uploads.acquire(commandBuffer);
+		else {
+			const uint32_t uploadZone = _gpuProfiler.begin(commandBuffer, "uploads", VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+			_uploads.flush(commandBuffer, static_cast<uint32_t>(_currentFrame));
+			_gpuProfiler.end(commandBuffer, uploadZone, VK_PIPELINE_STAGE_TRANSFER_BIT);
+		}
+
+		// the vertex shader only scales and offsets, world space is the clip volume seen along +z
+		glm::vec4 planes[6];
+		FrustumCuller::extractPlanes(glm::mat4(1.f), planes);
+
+		// a single indirect draw covers every object when GPU-driven, or every visible meshlet of the first object
+		size_t drawCount = _settings.gpuDriven || _settings.clusterCulling ? 1 : _settings.drawCount;
+		if (_settings.cpuCulling) {
+			PROFILE_ZONE("cpu culling")
+			const auto cullStart = std::chrono::steady_clock::now();
+			drawCount = _frustumCuller.cull(planes, _visibleObjects, _jobSystem);
+			const std::chrono::duration<double, std::milli> cullTime = std::chrono::steady_clock::now() - cullStart;
+			_cpuCullMilliseconds += cullTime.count();
+			_cpuVisibleObjects += drawCount;
 		}
-			
+
+		if (_settings.gpuDriven) {
+			const uint32_t cullZone = _gpuProfiler.begin(commandBuffer, "object culling", VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+			_objectCuller.cull(commandBuffer, static_cast<uint32_t>(_currentFrame), planes);
+			_gpuProfiler.end(commandBuffer, cullZone, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		}
+		else if (_settings.clusterCulling) {
+			// meshlets are drawn as the first object: planes go to its mesh space. Clip space y points down,
+			// which mirrors the winding: front faces have +z normals, so the cones are tested against -z
+			const glm::vec4 transform = objectTransform(0);
+			glm::vec4 meshPlanes[6];
+			for (int i = 0; i < 6; ++i)
+				meshPlanes[i] = glm::vec4(planes[i].x, planes[i].y, planes[i].z,
+					(glm::dot(glm::vec3(planes[i]), glm::vec3(transform)) + planes[i].w) / transform.w);
+			const glm::vec4 camera(0.f, 0.f, -1.f, 0.f);
+
+			const uint32_t cullZone = _gpuProfiler.begin(commandBuffer, "cluster culling", VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+			_clusterCuller.cull(commandBuffer, static_cast<uint32_t>(_currentFrame), meshPlanes, camera);
+			_gpuProfiler.end(commandBuffer, cullZone, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		}
+
+		VkRenderPassBeginInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = _renderPass;
+		renderPassInfo.framebuffer = _swapChainFramebuffers[imageIndex];
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = _swapChainExtent;
+
+		VkClearValue clearColor = { 0.15f, 0.15f, 0.15f, 1.f };
+		renderPassInfo.clearValueCount = 1;
+		renderPassInfo.pClearValues = &clearColor;
+
+		// objects drawn one by one: one command per object, sorted by state. The single pipeline and mesh
+		// of the app only need to be bound once per secondary buffer, the counters show it
+		const bool queued = !_settings.gpuDriven && !_settings.clusterCulling;
+		_renderQueue.clear();
+		if (queued && _mesh.ready()) {
+			PROFILE_ZONE("render queue")
+			for (size_t i = 0; i < drawCount; ++i) {
+				const uint32_t object = _settings.cpuCulling ? _visibleObjects[i] : static_cast<uint32_t>(i);
+				_renderQueue.push(0, 0.f, { _renderPipeline, RenderQueue::NONE, _renderGeometry, 0, _mesh.indexCount(), 0, object, 1 });
+			}
+
+			const auto sortStart = std::chrono::steady_clock::now();
+			_renderQueue.sort(&_jobSystem);
+			const std::chrono::duration<double, std::milli> sortTime = std::chrono::steady_clock::now() - sortStart;
+			_sortMilliseconds += sortTime.count();
+		}
+		if (queued)
+			drawCount = _renderQueue.size();
+
+		const uint32_t slot = static_cast<uint32_t>(_currentFrame);
+		const CommandRecorder::RecordFunction recordDraws = [this, slot, queued](VkCommandBuffer commandBuffer, size_t first, size_t count) {
+			if (queued) {
+				_renderQueue.record(commandBuffer, first, count);
+				return;
+			}
+
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
+			// a mesh file still streaming in is not drawn yet
+			if (!_mesh.ready())
+				return;
+
+			_mesh.bind(commandBuffer);
+			const VkDeviceSize offset = 0;
+			vkCmdBindVertexBuffers(commandBuffer, _mesh.streamCount(), 1, &_objects, &offset);
+
+			if (_settings.gpuDriven)
+				_objectCuller.draw(commandBuffer, slot);
+			else
+				_clusterCuller.draw(commandBuffer, slot);
+		};
+
+		const uint32_t mainPassZone = _gpuProfiler.begin(commandBuffer, "main pass");
+		_commandRecorder.record(commandBuffer, static_cast<uint32_t>(_currentFrame), renderPassInfo, drawCount, recordDraws);
+		const RenderQueue::Stats queueStats = _renderQueue.stats();
+		_renderQueueTotals.draws += queueStats.draws;
+		_renderQueueTotals.pipelineBinds += queueStats.pipelineBinds;
+		_renderQueueTotals.materialBinds += queueStats.materialBinds;
+		_renderQueueTotals.geometryBinds += queueStats.geometryBinds;
+		_renderQueueTotals.skippedBinds += queueStats.skippedBinds;
+		_gpuProfiler.end(commandBuffer, mainPassZone);
+
+		// release to the present family, the render pass already left the image in present layout; nothing
+		// comes back the other way since the next render pass starts from an undefined layout
+		if (_swapChainOwnershipTransfer) {
+			const QueueFamilyIndices& queueFamilyIndices = _queueFamilyIndices;
+
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+			barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+			barrier.srcQueueFamilyIndex = queueFamilyIndices.graphicsFamily;
+			barrier.dstQueueFamilyIndex = queueFamilyIndices.presentFamily;
+			barrier.image = _swapChainImages[imageIndex];
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+				0, nullptr, 0, nullptr, 1, &barrier);
+		}
+
+		VkResult result = vkEndCommandBuffer(commandBuffer);
+		if(result != VK_SUCCESS)
+			THROW("failed to record command buffer with error: " + std::to_string(result))
+
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		_recordMilliseconds += elapsed.count();
+		_maxRecordMilliseconds = std::max(_maxRecordMilliseconds, elapsed.count());
 	}
 
-	void App::createSemaphores()
+	void App::createSyncObjects()
 	{
+		_imageAvailableSemaphores.resize(_settings.framesInFlight);
+		_renderFinishedSemaphores.resize(_settings.framesInFlight);
+		_inFlightFences.resize(_settings.framesInFlight);
+		_imagesInFlight.resize(_swapChainImages.size(), VK_NULL_HANDLE);
+
 		VkSemaphoreCreateInfo semaphoreInfo = {};
 		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-		VkResult result = vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_imageAvailableSemaphore);
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+		for (size_t i = 0; i < _settings.framesInFlight; ++i) {
+			VkResult result = vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_imageAvailableSemaphores[i]);
+			if (result != VK_SUCCESS)
+				THROW("failed to create semaphore with error: " + std::to_string(result))
+
+			result = vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_renderFinishedSemaphores[i]);
+			if (result != VK_SUCCESS)
+				THROW("failed to create semaphore with error: " + std::to_string(result))
+
+			result = vkCreateFence(_device, &fenceInfo, nullptr, &_inFlightFences[i]);
+			if (result != VK_SUCCESS)
+				THROW("failed to create fence with error: " + std::to_string(result))
+		}
+	}
+
+	void App::createReadback()
+	{
+		const QueueFamilyIndices& queueFamilyIndices = _queueFamilyIndices;
+
+		_readback.init(_device, _memoryAllocator, queueFamilyIndices.graphicsFamily,
+			_swapChainExtent, _settings.readbackSlots, _settings.readbackCallback);
+	}
+
+	void App::createUploads()
+	{
+		const QueueFamilyIndices& queueFamilyIndices = _queueFamilyIndices;
+		const uint32_t graphicsFamily = queueFamilyIndices.graphicsFamily;
+
+		_uploads.init(_device, _memoryAllocator, _settings.framesInFlight,
+			_uploadQueue != VK_NULL_HANDLE ? _uploadFamily : graphicsFamily, graphicsFamily);
+
+		if (_uploadQueue != VK_NULL_HANDLE) {
+			VkCommandPoolCreateInfo poolInfo = {};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.queueFamilyIndex = _uploadFamily;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+			VkSemaphoreCreateInfo semaphoreInfo = {};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+			_uploadCommandPools.resize(_settings.framesInFlight);
+			_uploadCommandBuffers.resize(_settings.framesInFlight);
+			_uploadSemaphores.resize(_settings.framesInFlight);
+			for (size_t i = 0; i < _settings.framesInFlight; ++i) {
+				VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &_uploadCommandPools[i]);
+				if (result != VK_SUCCESS)
+					THROW("failed to create upload command pool with error: " + std::to_string(result))
+
+				VkCommandBufferAllocateInfo allocInfo = {};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.commandPool = _uploadCommandPools[i];
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				allocInfo.commandBufferCount = 1;
+
+				result = vkAllocateCommandBuffers(_device, &allocInfo, &_uploadCommandBuffers[i]);
+				if (result != VK_SUCCESS)
+					THROW("failed to allocate upload command buffer with error: " + std::to_string(result))
+
+				result = vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_uploadSemaphores[i]);
+				if (result != VK_SUCCESS)
+					THROW("failed to create upload semaphore with error: " + std::to_string(result))
+			}
+		}
+
+		if (!_settings.uploadCount)
+			return;
+
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = static_cast<VkDeviceSize>(_settings.uploadCount) * UPLOAD_CHUNK_SIZE;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkResult result = vkCreateBuffer(_device, &bufferInfo, nullptr, &_uploadTarget);
 		if (result != VK_SUCCESS)
-			THROW("failed to create semaphore with error: " + result)
+			THROW("failed to create upload target buffer with error: " + std::to_string(result))
+
+		_uploadTargetMemory = _memoryAllocator.bind(_uploadTarget, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+
+	void App::createMesh()
+	{
+		if (!_settings.meshFile.empty()) {
+			loadMeshFile();
+			createObjects();
+			return;
+		}
+
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+
+		if (!_settings.meshSize) {
+			vertices = {
+				{ { 0.f, -.5f, 0.f }, { 1.f, 0.f, 0.f } },
+				{ { .5f, .5f, 0.f }, { 0.f, 1.f, 0.f } },
+				{ { -.5f, .5f, 0.f }, { 0.f, 0.f, 1.f } }
+			};
+			indices = { 0, 1, 2 };
+		}
+		else {
+			// a screen covering grid, big enough to make vertex fetch show up in the frame time
+			const uint size = _settings.meshSize;
+			vertices.reserve((size + 1) * (size + 1));
+			for (uint y = 0; y <= size; ++y)
+				for (uint x = 0; x <= size; ++x) {
+					const glm::vec2 uv = glm::vec2(x, y) / static_cast<float>(size);
+					vertices.push_back({ glm::vec3(uv * 2.f - 1.f, 0.f), glm::vec3(uv, 1.f - uv.x) });
+				}
+
+			indices.reserve(size * size * 6);
+			for (uint y = 0; y < size; ++y)
+				for (uint x = 0; x < size; ++x) {
+					const uint32_t corner = y * (size + 1) + x;
+					const uint32_t quad[] = { corner, corner + 1, corner + size + 2, corner, corner + size + 2, corner + size + 1 };
+					indices.insert(indices.end(), std::begin(quad), std::end(quad));
+				}
+		}
+
+		const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+		_mesh.init(_device, _memoryAllocator, _vertexInput, vertexCount, static_cast<uint32_t>(indices.size()));
+
+		std::vector<glm::vec3> positions;
+		positions.reserve(vertices.size());
+		for (const auto& vertex : vertices)
+			positions.push_back(vertex.position);
+		if (_settings.clusterCulling)
+			MeshletBuilder::build(indices.data(), indices.size(), positions.data(), vertexCount, 0, _meshlets);
+
+		glm::vec3 min = positions.front(), max = positions.front();
+		for (const auto& position : positions) {
+			min = glm::min(min, position);
+			max = glm::max(max, position);
+		}
+		_meshSphere = glm::vec4((min + max) * .5f, 0.f);
+		for (const auto& position : positions)
+			_meshSphere.w = std::max(_meshSphere.w, glm::length(position - glm::vec3(_meshSphere)));
+
+		if (!_mesh.upload(_uploads, packVertices(vertices, _settings).data(), indices.data()))
+			THROW("mesh of " + std::to_string(_mesh.size()) + " bytes does not fit in the upload ring")
+
+		REPORT("mesh: " << vertexCount << " vertices, " << indices.size() / 3 << " triangles, "
+			<< (_vertexInput.layout == VertexLayout::Interleaved ? "interleaved" : "deinterleaved") << ", "
+			<< _vertexInput.vertexSize << " bytes per vertex, " << _mesh.size() / 1024 << " KB ("
+			<< (static_cast<double>(vertexCount) * (ColorVertexFormat::stride - _vertexInput.vertexSize)) / 1024. << " KB saved by quantization)")
+
+		createObjects();
+	}
+
+	void App::loadMeshFile()
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const bool loaded = _settings.meshFileRead ? _meshFile.read(_settings.meshFile) : _meshFile.map(_settings.meshFile);
+		if (!loaded)
+			THROW("failed to load mesh file " + _settings.meshFile)
+		if (!_meshFile.matches(_vertexInput))
+			THROW("mesh file " + _settings.meshFile + " was converted for another vertex format, convert it with the same --deinterleaved and --quantized options")
+
+		// the file's sections are copied straight into the upload ring by the following frames
+		const MeshFile::Header& header = _meshFile.header();
+		_mesh.init(_device, _memoryAllocator, _vertexInput, header.vertexCount, header.indexCount);
+		_mesh.stream(_meshFile.vertices(), _meshFile.indices());
+		if (_settings.clusterCulling)
+			_meshlets.assign(_meshFile.meshlets(), _meshFile.meshlets() + header.meshletCount);
+
+		const glm::vec3 min(header.bounds.min[0], header.bounds.min[1], header.bounds.min[2]);
+		const glm::vec3 max(header.bounds.max[0], header.bounds.max[1], header.bounds.max[2]);
+		_meshSphere = glm::vec4((min + max) * .5f, glm::length(max - min) * .5f);
+		_meshStreamStart = std::chrono::steady_clock::now();
+
+		const double loadTime = std::chrono::duration<double, std::milli>(_meshStreamStart - start).count();
+		REPORT("mesh file " << _settings.meshFile << (_settings.meshFileRead ? " read" : " mapped") << " in "
+			<< loadTime << "ms: " << header.vertexCount << " vertices, "
+			<< header.indexCount / 3 << " triangles, " << header.submeshCount << " submeshes, " << _meshFile.size() / 1024 << " KB")
+	}
 
-		result = vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_renderFinishedSemaphore);
+	VertexInputDescription App::vertexInputDescription(const Settings& settings)
+	{
+		return settings.quantizedVertices ? QuantizedVertexFormat::description(settings.vertexLayout)
+			: ColorVertexFormat::description(settings.vertexLayout);
+	}
+
+	std::vector<char> App::packVertices(const std::vector<Vertex>& vertices, const Settings& settings)
+	{
+		if (!settings.quantizedVertices)
+			return layoutVertices<ColorVertexFormat>(vertices, settings.vertexLayout);
+
+		std::vector<QuantizedVertex> quantized;
+		quantized.reserve(vertices.size());
+		for (const auto& vertex : vertices)
+			quantized.push_back({ VertexPacking::packPosition(vertex.position), VertexPacking::packColor(glm::vec4(vertex.color, 1.f)) });
+
+		return layoutVertices<QuantizedVertexFormat>(quantized, settings.vertexLayout);
+	}
+
+	template<typename Format, typename VertexType>
+	std::vector<char> App::layoutVertices(const std::vector<VertexType>& vertices, VertexLayout layout)
+	{
+		std::vector<char> data(vertices.size() * sizeof(VertexType));
+		if (layout == VertexLayout::Deinterleaved)
+			Format::deinterleave(vertices.data(), vertices.size(), data.data());
+		else
+			std::memcpy(data.data(), vertices.data(), data.size());
+
+		return data;
+	}
+
+	bool App::convertMeshes(const std::vector<MeshConversion>& conversions, const Settings& settings)
+	{
+		util::JobSystem jobSystem;
+		jobSystem.init(settings.workerCount());
+
+		std::vector<SourceMesh> meshes(conversions.size());
+		std::vector<MeshOptimizer::CacheStats> before(conversions.size());
+		std::vector<char> converted(conversions.size(), false);
+
+		jobSystem.parallelFor(conversions.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				converted[i] = MeshConverter::loadObj(conversions[i].input, meshes[i]);
+				if (converted[i])
+					before[i] = MeshOptimizer::analyzeVertexCache(meshes[i].indices.data(), meshes[i].indices.size(),
+						static_cast<uint32_t>(meshes[i].positions.size()));
+			}
+		});
+
+		// submeshes of all meshes form one flat list, so one big mesh does not serialize the pass
+		if (settings.optimizeMeshes) {
+			std::vector<std::pair<size_t, size_t>> submeshes;
+			for (size_t i = 0; i < meshes.size(); ++i)
+				for (size_t j = 0; converted[i] && j < meshes[i].submeshes.size(); ++j)
+					submeshes.emplace_back(i, j);
+
+			jobSystem.parallelFor(submeshes.size(), 1, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i)
+					MeshConverter::optimizeSubmesh(meshes[submeshes[i].first], submeshes[i].second);
+			});
+		}
+
+		jobSystem.parallelFor(conversions.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				if (!converted[i])
+					continue;
+
+				SourceMesh& source = meshes[i];
+				if (settings.optimizeMeshes)
+					MeshConverter::optimizeVertexFetch(source);
+				MeshConverter::buildMeshlets(source);
+				const MeshOptimizer::CacheStats after = MeshOptimizer::analyzeVertexCache(source.indices.data(), source.indices.size(),
+					static_cast<uint32_t>(source.positions.size()));
+
+				std::vector<Vertex> vertices;
+				vertices.reserve(source.positions.size());
+				for (size_t v = 0; v < source.positions.size(); ++v)
+					vertices.push_back({ source.positions[v], source.colors[v] });
+
+				converted[i] = MeshFile::write(conversions[i].output, vertexInputDescription(settings), static_cast<uint32_t>(vertices.size()),
+					packVertices(vertices, settings).data(), source.indices, source.submeshes, source.meshlets, source.bounds);
+				if (!converted[i])
+					continue;
+
+				REPORT("converted " << conversions[i].input << " to " << conversions[i].output << ": " << vertices.size() << " vertices, "
+					<< source.indices.size() / 3 << " triangles, " << source.submeshes.size() << " submeshes, " << source.meshlets.size()
+					<< " meshlets, ACMR " << before[i].acmr << " -> "
+					<< after.acmr << ", ATVR " << before[i].atvr << " -> " << after.atvr)
+			}
+		});
+
+		jobSystem.clean();
+		return std::all_of(converted.begin(), converted.end(), [](char success) { return success; });
+	}
+
+	glm::vec4 App::objectTransform(uint index) const
+	{
+		// a square grid over spread x spread screens, one object is the mesh as is
+		const uint columns = static_cast<uint>(std::ceil(std::sqrt(static_cast<double>(std::max(_settings.drawCount, 1u)))));
+		const float cell = 2.f * _settings.objectSpread / columns;
+		const glm::vec2 offset = glm::vec2(index % columns + .5f, index / columns + .5f) * cell - _settings.objectSpread;
+
+		return glm::vec4(offset, 0.f, _settings.objectSpread / columns);
+	}
+
+	void App::createObjects()
+	{
+		const uint objectCount = std::max(_settings.drawCount, 1u);
+		_scene.clear();
+		for (uint i = 0; i < objectCount; ++i)
+			_scene.create(ObjectTransform{ objectTransform(i) }, ObjectBounds{}, ObjectMesh{ 0, _mesh.indexCount() });
+
+		// transform update: world bounds of every object
+		const glm::vec4 meshSphere = _meshSphere;
+		_scene.parallelForEachChunk<const ObjectTransform, ObjectBounds>(_jobSystem,
+			[meshSphere](const Entity*, size_t count, const ObjectTransform* transforms, ObjectBounds* bounds) {
+				for (size_t i = 0; i < count; ++i) {
+					const glm::vec4& transform = transforms[i].offsetScale;
+					bounds[i].sphere = glm::vec4(glm::vec3(meshSphere) * transform.w + glm::vec3(transform), meshSphere.w * transform.w);
+				}
+			});
+
+		// the objects all share one archetype, chunk order is creation order and so instance order
+		std::vector<DrawObject> objects;
+		objects.reserve(objectCount);
+		if (_settings.cpuCulling)
+			_frustumCuller.reserve(objectCount);
+		_scene.forEachChunk<const ObjectTransform, const ObjectBounds, const ObjectMesh>([this, &objects](const Entity*, size_t count,
+			const ObjectTransform* transforms, const ObjectBounds* bounds, const ObjectMesh* meshes) {
+			for (size_t i = 0; i < count; ++i) {
+				objects.push_back({ transforms[i].offsetScale, _meshSphere, meshes[i].firstIndex, meshes[i].indexCount, {} });
+				if (_settings.cpuCulling)
+					_frustumCuller.add(bounds[i].sphere);
+			}
+		});
+
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = objects.size() * sizeof(DrawObject);
+		bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkResult result = vkCreateBuffer(_device, &bufferInfo, nullptr, &_objects);
 		if (result != VK_SUCCESS)
-			THROW("failed to create semaphore with error: " + result)
+			THROW("failed to create object buffer with error: " + std::to_string(result))
+
+		_objectsMemory = _memoryAllocator.bind(_objects, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (!_uploads.upload(_objects, 0, objects.data(), bufferInfo.size))
+			THROW("objects of " + std::to_string(bufferInfo.size) + " bytes do not fit in the upload ring")
+	}
+
+	void App::createObjectCuller()
+	{
+		_objectCuller.init(_device, _memoryAllocator, _pipelineCache.handle(), _objectCullShaderCode, _settings.framesInFlight,
+			_objects, std::max(_settings.drawCount, 1u), _drawIndirectCount, _multiDrawIndirect);
+
+		LOG(LogInfo, "GPU-driven objects: " << _settings.drawCount << " over " << _settings.objectSpread << "x" << _settings.objectSpread
+			<< " screens, " << (_drawIndirectCount ? "draw indirect count" : _multiDrawIndirect ? "multi draw indirect" : "one draw indirect per object"))
+
+		std::vector<char>().swap(_objectCullShaderCode);
+	}
+
+	void App::createRenderQueue()
+	{
+		_renderPipeline = _renderQueue.addPipeline(_graphicsPipeline, _pipelineLayout);
+		_renderGeometry = _renderQueue.addGeometry(&_mesh, _objects);
+		_renderQueue.reserve(_settings.drawCount);
+	}
+
+	void App::createClusterCuller()
+	{
+		_clusterCuller.init(_device, _memoryAllocator, _uploads, _pipelineCache.handle(), _cullShaderCode, _settings.framesInFlight,
+			_meshlets.data(), static_cast<uint32_t>(_meshlets.size()), _multiDrawIndirect);
+
+		LOG(LogInfo, "cluster culling: " << _meshlets.size() << " meshlets of up to " << Meshlet::MAX_VERTICES << " vertices and "
+			<< Meshlet::MAX_TRIANGLES << " triangles, " << (_multiDrawIndirect ? "multi" : "single") << " draw indirect")
+
+		std::vector<Meshlet>().swap(_meshlets);
+		std::vector<char>().swap(_cullShaderCode);
+	}
+
+	void App::streamUploads()
+	{
+		PROFILE_ZONE("stream uploads")
+
+		// with a mapped file this is where the pages are actually read
+		if (!_mesh.ready() && _mesh.update(_uploads, MESH_STREAM_BUDGET)) {
+			const double streamTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _meshStreamStart).count();
+			REPORT("mesh file streamed in " << streamTime << "ms")
+			_meshFile.close();
+		}
+
+		std::array<uint32_t, UPLOAD_CHUNK_SIZE / sizeof(uint32_t)> chunk;
+		chunk.fill(static_cast<uint32_t>(_frameNumber));
+
+		for (uint i = 0; i < _settings.uploadCount; ++i)
+			_uploads.upload(_uploadTarget, static_cast<VkDeviceSize>(i) * UPLOAD_CHUNK_SIZE, chunk.data(), UPLOAD_CHUNK_SIZE);
 	}
 
 	VkShaderModule App::createShaderModule(const std::vector<char>& code)
@@ -559,6 +1408,9 @@ namespace core
 	{
 		QueueFamilyIndices indices = findQueueFamilies(device);
 
+		if (_settings.headless)
+			return indices.isComplete();
+
 		bool extensionsSupported = checkDeviceExtensionSupport(device);
 
 		bool swapChainAdequate = false;
@@ -582,24 +1434,51 @@ namespace core
 
 		uint i = 0;
 		for (const auto& queueFamily : queueFamilies) {
-			if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+			if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT && indices.graphicsFamily < 0)
 				indices.graphicsFamily = i;
 
-			VkBool32 presentSupport = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
+			if (!_settings.headless && indices.presentFamily < 0) {
+				VkBool32 presentSupport = false;
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
 
-			if (queueFamily.queueCount > 0 && presentSupport)
-				indices.presentFamily = i;
+				if (queueFamily.queueCount > 0 && presentSupport)
+					indices.presentFamily = i;
+			}
 
-			if (indices.isComplete())
-				break;
+			// dedicated families usually map to separate hardware engines (async compute, DMA)
+			const VkQueueFlags flags = queueFamily.queueFlags;
+			if (queueFamily.queueCount > 0 && !(flags & VK_QUEUE_GRAPHICS_BIT) && flags & VK_QUEUE_COMPUTE_BIT && indices.computeFamily < 0) {
+				indices.computeFamily = i;
+				indices.computeQueueCount = queueFamily.queueCount;
+			}
+
+			if (queueFamily.queueCount > 0 && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && flags & VK_QUEUE_TRANSFER_BIT && indices.transferFamily < 0) {
+				indices.transferFamily = i;
+				indices.transferQueueCount = queueFamily.queueCount;
+			}
 
 			++i;
 		}
 
+		// without a surface nothing is presented, the graphics queue stands in for the present queue
+		if (_settings.headless)
+			indices.presentFamily = indices.graphicsFamily;
+
 		return indices;
 	}
 
+	bool App::hasDeviceExtension(VkPhysicalDevice device, const char* name)
+	{
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+		return std::any_of(availableExtensions.begin(), availableExtensions.end(),
+			[name](const VkExtensionProperties& extension) { return !std::strcmp(extension.extensionName, name); });
+	}
+
 	bool App::checkDeviceExtensionSupport(VkPhysicalDevice device)
 	{
 		uint32_t extensionCount;
@@ -677,7 +1556,7 @@ namespace core
 		if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
 			return capabilities.currentExtent;
 		else {
-			VkExtent2D actualExtent = { WIDTH, HEIGHT };
+			VkExtent2D actualExtent = { _settings.width, _settings.height };
 
 			actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
 			actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
@@ -687,45 +1566,173 @@ namespace core
 
 	void App::loop()
 	{
-		while (!glfwWindowShouldClose(_window)) {
-			glfwPollEvents();
+		const auto start = std::chrono::steady_clock::now();
+		uint frames = 0;
+
+		while (_settings.headless || !glfwWindowShouldClose(_window)) {
+			PROFILE_ZONE("frame")
+
+			if (!_settings.headless)
+				glfwPollEvents();
 			drawFrame();
+
+			if (++frames == 1)
+				logStartup();
+			if (frames == _settings.frameCount)
+				break;
 		}
 
 		vkDeviceWaitIdle(_device);
+
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		REPORT(frames << " frames in " << elapsed.count() << "s with " << _settings.framesInFlight
+			<< " frames in flight (" << frames / elapsed.count() << " fps)")
+		REPORT("command recording of " << _settings.drawCount << " draws on " << _commandRecorder.threadCount()
+			<< " threads: " << _recordMilliseconds / std::max(frames, 1u) << "ms per frame, " << _maxRecordMilliseconds << "ms max")
+
+		const UploadManager::Stats uploadStats = _uploads.stats();
+		if (uploadStats.uploads)
+			REPORT("uploads: " << uploadStats.uploads / std::max(frames, 1u) << " per frame in " << uploadStats.copyCommands
+				<< " copy commands over " << uploadStats.batches << " batches, " << uploadStats.bytes / (1024. * 1024.) << " MB, "
+				<< uploadStats.rejected << " rejected, " << uploadStats.peakUsage / 1024 << " KB peak ring usage")
+
+		if (_renderQueueTotals.draws) {
+			const uint64_t binds = _renderQueueTotals.pipelineBinds + _renderQueueTotals.materialBinds + _renderQueueTotals.geometryBinds;
+			REPORT("render queue: " << _renderQueueTotals.draws / std::max(frames, 1u) << " draws and " << binds / std::max(frames, 1u)
+				<< " binds per frame (" << _renderQueueTotals.pipelineBinds / std::max(frames, 1u) << " pipeline, "
+				<< _renderQueueTotals.materialBinds / std::max(frames, 1u) << " material, " << _renderQueueTotals.geometryBinds / std::max(frames, 1u)
+				<< " geometry), " << _renderQueueTotals.skippedBinds / std::max(frames, 1u) << " redundant binds skipped, sort "
+				<< _sortMilliseconds / std::max(frames, 1u) << "ms per frame")
+		}
+
+		if (_settings.cpuCulling)
+			REPORT("CPU culling (" << FrustumCuller::WIDTH << " wide): " << _cpuVisibleObjects / std::max(frames, 1u) << " of "
+				<< _frustumCuller.size() << " objects visible per frame, " << _cpuCullMilliseconds / std::max(frames, 1u) << "ms per frame")
+
+		if (_settings.gpuDriven) {
+			const ObjectCuller::Stats objectStats = _objectCuller.stats();
+			if (objectStats.frames)
+				REPORT("object culling: " << objectStats.visibleObjects / objectStats.frames << " of " << objectStats.objects / objectStats.frames
+					<< " objects visible per frame")
+		}
+
+		if (_settings.clusterCulling) {
+			const ClusterCuller::Stats cullStats = _clusterCuller.stats();
+			if (cullStats.frames)
+				REPORT("cluster culling: " << cullStats.visibleMeshlets / cullStats.frames << " of " << cullStats.meshlets / cullStats.frames
+					<< " meshlets visible per frame, " << 100. * (cullStats.triangles - cullStats.visibleTriangles) / std::max<uint64_t>(cullStats.triangles, 1)
+					<< "% of triangles rejected")
+		}
+
+		for (const auto& total : _gpuProfiler.totals())
+			REPORT("GPU " << total.first << ": " << total.second.milliseconds / total.second.count << "ms per frame")
 	}
 
 	void App::drawFrame()
 	{
-		vkQueueWaitIdle(_presentQueue);
+		{
+			PROFILE_ZONE("wait frame fence")
+			vkWaitForFences(_device, 1, &_inFlightFences[_currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+		}
+
+		uint32_t imageIndex = static_cast<uint32_t>(_currentFrame);
+		{
+			PROFILE_ZONE("acquire")
+			if (!_settings.headless)
+				vkAcquireNextImageKHR(_device, _swapChain, std::numeric_limits<uint64_t>::max(), _imageAvailableSemaphores[_currentFrame], VK_NULL_HANDLE, &imageIndex);
+
+			// the image may still be used by a frame that was acquired out of order
+			if (_imagesInFlight[imageIndex] != VK_NULL_HANDLE)
+				vkWaitForFences(_device, 1, &_imagesInFlight[imageIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+			_imagesInFlight[imageIndex] = _inFlightFences[_currentFrame];
+		}
 
-		uint32_t imageIndex;
-		vkAcquireNextImageKHR(_device, _swapChain, std::numeric_limits<uint64_t>::max(), _imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+		recordCommandBuffer(imageIndex);
 
 		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-		VkSemaphore waitSemaphores[] = { _imageAvailableSemaphore };
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = waitSemaphores;
-		submitInfo.pWaitDstStageMask = waitStages;
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<VkPipelineStageFlags> waitStages;
+		if (!_settings.headless) {
+			waitSemaphores.push_back(_imageAvailableSemaphores[_currentFrame]);
+			waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+		}
+		if (_uploadsPending) {
+			waitSemaphores.push_back(_uploadSemaphores[_currentFrame]);
+			waitStages.push_back(UploadManager::CONSUMER_STAGES);
+		}
+
+		submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+		submitInfo.pWaitSemaphores = waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = waitStages.data();
 		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &_commandBuffers[imageIndex];
+		submitInfo.pCommandBuffers = &_commandBuffers[_currentFrame];
 
-		VkSemaphore signalSemaphores[] = { _renderFinishedSemaphore };
-		submitInfo.signalSemaphoreCount = 1;
+		VkSemaphore signalSemaphores[] = { _renderFinishedSemaphores[_currentFrame] };
+		submitInfo.signalSemaphoreCount = _settings.headless ? 0 : 1;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
-		VkResult result = vkQueueSubmit(_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-		if (result != VK_SUCCESS)
-			THROW("failed to submit draw command buffer with error: " + result)
+		{
+			PROFILE_ZONE("submit")
+			vkResetFences(_device, 1, &_inFlightFences[_currentFrame]);
+
+			if (_uploadsPending) {
+				VkSubmitInfo uploadSubmitInfo = {};
+				uploadSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+				uploadSubmitInfo.commandBufferCount = 1;
+				uploadSubmitInfo.pCommandBuffers = &_uploadCommandBuffers[_currentFrame];
+				uploadSubmitInfo.signalSemaphoreCount = 1;
+				uploadSubmitInfo.pSignalSemaphores = &_uploadSemaphores[_currentFrame];
+
+				VkResult result = vkQueueSubmit(_uploadQueue, 1, &uploadSubmitInfo, VK_NULL_HANDLE);
+				if (result != VK_SUCCESS)
+					THROW("failed to submit upload command buffer with error: " + std::to_string(result))
+			}
+
+			VkResult result = vkQueueSubmit(_graphicsQueue, 1, &submitInfo, _inFlightFences[_currentFrame]);
+			if (result != VK_SUCCESS)
+				THROW("failed to submit draw command buffer with error: " + std::to_string(result))
+
+			if (_settings.readback)
+				_readback.enqueue(_graphicsQueue, _swapChainImages[imageIndex], _frameNumber);
+		}
+
+		const size_t frame = _currentFrame;
+		++_frameNumber;
+		_currentFrame = (_currentFrame + 1) % _settings.framesInFlight;
+
+		if (_settings.headless)
+			return;
+
+		PROFILE_ZONE("present")
 
 		VkPresentInfoKHR presentInfo = {};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 		presentInfo.waitSemaphoreCount = 1;
 		presentInfo.pWaitSemaphores = signalSemaphores;
 
+		// the present queue acquires the image released by the frame before presenting it
+		if (_swapChainOwnershipTransfer) {
+			const VkPipelineStageFlags acquireWaitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+			VkSubmitInfo acquireSubmitInfo = {};
+			acquireSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			acquireSubmitInfo.waitSemaphoreCount = 1;
+			acquireSubmitInfo.pWaitSemaphores = signalSemaphores;
+			acquireSubmitInfo.pWaitDstStageMask = &acquireWaitStage;
+			acquireSubmitInfo.commandBufferCount = 1;
+			acquireSubmitInfo.pCommandBuffers = &_presentCommandBuffers[imageIndex];
+			acquireSubmitInfo.signalSemaphoreCount = 1;
+			acquireSubmitInfo.pSignalSemaphores = &_presentReadySemaphores[frame];
+
+			VkResult result = vkQueueSubmit(_presentQueue, 1, &acquireSubmitInfo, VK_NULL_HANDLE);
+			if (result != VK_SUCCESS)
+				THROW("failed to submit present acquire with error: " + std::to_string(result))
+
+			presentInfo.pWaitSemaphores = &_presentReadySemaphores[frame];
+		}
+
 		VkSwapchainKHR swapChains[] = { _swapChain };
 		presentInfo.swapchainCount = 1;
 		presentInfo.pSwapchains = swapChains;
@@ -737,26 +1744,91 @@ namespace core
 
 	void App::clean()
 	{
-		vkDestroySemaphore(_device, _renderFinishedSemaphore, nullptr);
-		vkDestroySemaphore(_device, _imageAvailableSemaphore, nullptr);
-		vkDestroyCommandPool(_device, _commandPool, nullptr);
+		if (!_settings.tracePath.empty() && !PROFILE_EXPORT(_settings.tracePath))
+			LOG(LogWarning, "failed to export trace to " << _settings.tracePath)
+
+		if (_settings.readback) {
+			_readback.clean();
+
+			const FrameReadback::Stats stats = _readback.stats();
+			if (stats.completed)
+				REPORT("readback " << _swapChainExtent.width << 'x' << _swapChainExtent.height << ": "
+					<< stats.completed << " frames, " << stats.dropped << " dropped, "
+					<< stats.completed / stats.seconds << " fps, " << stats.bytes / stats.seconds / (1024. * 1024.) << " MB/s")
+		}
+
+		const MemoryAllocator::Stats memoryStats = _memoryAllocator.stats();
+		REPORT("device memory: " << memoryStats.allocationCount << " allocations in " << memoryStats.blockCount << " blocks and "
+			<< memoryStats.dedicatedCount << " dedicated, " << memoryStats.deviceAllocateCalls << " vkAllocateMemory for "
+			<< memoryStats.allocateCalls << " requests, " << memoryStats.used / (1024. * 1024.) << " of "
+			<< memoryStats.reserved / (1024. * 1024.) << " MB used, " << memoryStats.freeRangeCount << " free ranges, "
+			<< memoryStats.fragmentation * 100.f << "% fragmentation")
+
+		for (size_t i = 0; i < _settings.framesInFlight; ++i) {
+			vkDestroyFence(_device, _inFlightFences[i], nullptr);
+			vkDestroySemaphore(_device, _renderFinishedSemaphores[i], nullptr);
+			vkDestroySemaphore(_device, _imageAvailableSemaphores[i], nullptr);
+		}
+		_commandRecorder.clean();
+		_gpuProfiler.clean();
+		_renderQueue.clean();
+		_clusterCuller.clean();
+		_objectCuller.clean();
+		if (_objects != VK_NULL_HANDLE) {
+			vkDestroyBuffer(_device, _objects, nullptr);
+			_memoryAllocator.free(_objectsMemory);
+		}
+		_mesh.clean();
+		_uploads.clean();
+		for (size_t i = 0; i < _uploadCommandPools.size(); ++i) {
+			vkDestroySemaphore(_device, _uploadSemaphores[i], nullptr);
+			vkDestroyCommandPool(_device, _uploadCommandPools[i], nullptr);
+		}
+		if (_uploadTarget != VK_NULL_HANDLE) {
+			vkDestroyBuffer(_device, _uploadTarget, nullptr);
+			_memoryAllocator.free(_uploadTargetMemory);
+		}
+		for (auto& commandPool : _commandPools)
+			vkDestroyCommandPool(_device, commandPool, nullptr);
 
 		for (auto& swapChainFramebuffer : _swapChainFramebuffers)
 			vkDestroyFramebuffer(_device, swapChainFramebuffer, nullptr);
 
 		vkDestroyPipeline(_device, _graphicsPipeline, nullptr);
+		_pipelineCache.save();
+		_pipelineCache.clean();
 		vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
 		vkDestroyRenderPass(_device, _renderPass, nullptr);
 
 		for (auto& swapChainImageView : _swapChainImageViews)
 			vkDestroyImageView(_device, swapChainImageView, nullptr);
 
+		if (_settings.headless) {
+			for (size_t i = 0; i < _swapChainImages.size(); ++i) {
+				vkDestroyImage(_device, _swapChainImages[i], nullptr);
+				_memoryAllocator.free(_offscreenImageAllocations[i]);
+			}
+
+			_memoryAllocator.clean();
+			vkDestroyDevice(_device, nullptr);
+			vkDestroyInstance(_vkInstance, nullptr);
+			_jobSystem.clean();
+			return;
+		}
+
+		for (auto& semaphore : _presentReadySemaphores)
+			vkDestroySemaphore(_device, semaphore, nullptr);
+		if (_presentCommandPool != VK_NULL_HANDLE)
+			vkDestroyCommandPool(_device, _presentCommandPool, nullptr);
+
 		vkDestroySwapchainKHR(_device, _swapChain, nullptr);
+		_memoryAllocator.clean();
 		vkDestroyDevice(_device, nullptr);
 		vkDestroySurfaceKHR(_vkInstance, _surface, nullptr);
 		vkDestroyInstance(_vkInstance, nullptr);
 		glfwDestroyWindow(_window);
 		glfwTerminate();
+		_jobSystem.clean();
 	}
 
 	std::vector<char> App::readFile(const std::string & filename)
@@ -775,4 +1847,4 @@ namespace core
 		file.close();
 		return buffer;
 	}
-}
+}
\ No newline at end of file
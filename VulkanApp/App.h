@@ -3,44 +3,124 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
 
 #include <stdexcept>
 #include <vector>
 #include <array>
+#include <mutex>
+#include <chrono>
+#include <exception>
+#include <thread>
+#include <algorithm>
 
 #include "NonCopyable.h"
+#include "MemoryAllocator.h"
+#include "FrameReadback.h"
+#include "UploadManager.h"
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "ClusterCuller.h"
+#include "ObjectCuller.h"
+#include "FrustumCuller.h"
+#include "Scene.h"
+#include "RenderQueue.h"
+#include "VertexPacking.h"
+#include "PipelineCache.h"
+#include "CommandRecorder.h"
+#include "JobSystem.h"
+#include "GpuProfiler.h"
 
 #ifndef _DEBUG
 	#define LOGGING_DISABLE
 #endif
 
 #include "Logging.h"
+#include "Profiler.h"
 
 typedef unsigned int uint;
 
 namespace core
 {
+	// scene components of the drawn objects
+	struct ObjectTransform {
+		glm::vec4 offsetScale;	// xyz offset, w uniform scale, the instance attribute of the vertex shader
+	};
+
+	struct ObjectBounds {
+		glm::vec4 sphere;		// world space
+	};
+
+	struct ObjectMesh {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+	};
+
 	class App : public util::NonCopyable
 	{
 	public:
-		const uint WIDTH = 800;
-		const uint HEIGHT = 600;
-
 		const std::array<const char*, 1> deviceExtensions = {
 			VK_KHR_SWAPCHAIN_EXTENSION_NAME
 		};
 
+		struct Settings {
+			bool headless = false;
+			uint width = 800;
+			uint height = 600;
+			uint framesInFlight = 2;
+			uint frameCount = 0;
+			uint drawCount = 1;
+			uint workerThreads = 0;
+			uint uploadCount = 0;		// small uploads streamed every frame to exercise the upload path
+			bool transferQueue = true;
+			bool exclusiveSwapchain = false;	// keep swapchain images exclusive and transfer them to the present family
+
+			uint meshSize = 0;			// grid of meshSize x meshSize quads instead of the single triangle
+			VertexLayout vertexLayout = VertexLayout::Interleaved;
+			bool quantizedVertices = false;
+			std::string meshFile;		// converted with --convert, streamed in over frames
+			bool meshFileRead = false;	// read the mesh file into memory instead of mapping it, to compare load times
+			bool optimizeMeshes = true;	// reorder triangles and vertices of converted meshes
+			bool clusterCulling = false;	// cull meshlets in a compute pass and draw them indirectly
+			bool gpuDriven = false;		// cull the drawCount objects in a compute pass and draw them with one indirect call
+			float objectSpread = 1.f;	// the objects' grid covers spread x spread screens, so frustum culling has work
+			bool cpuCulling = false;	// cull the drawCount objects on the job system and record only the visible ones
+
+			std::string pipelineCachePath = "pipeline.cache";
+			std::string tracePath;		// debug builds only, PROFILING_DISABLE compiles the zones out of release builds
+
+			bool readback = false;
+			uint readbackSlots = 3;
+			FrameReadback::Callback readbackCallback;
+
+			// workerThreads, or one less than the hardware threads: the calling thread runs tasks as well while it waits
+			uint workerCount() const { return workerThreads ? workerThreads : std::max(std::thread::hardware_concurrency(), 2u) - 1; }
+		};
+
 		App() = default;
 		~App() = default;
 
-		void run();
+		void run(const Settings& settings);
+
+		struct MeshConversion {
+			std::string input;		// OBJ file
+			std::string output;		// mesh file
+		};
+
+		// converts OBJ files into mesh files in the vertex format the settings select, in parallel on
+		// settings.workerCount() threads, no device needed. Each mesh is optimized unless settings.optimizeMeshes is off.
+		static bool convertMeshes(const std::vector<MeshConversion>& conversions, const Settings& settings);
 
 	private:
+		Settings			_settings;
+		util::JobSystem		_jobSystem;
+
 		GLFWwindow*			_window;
 		VkInstance			_vkInstance;
 
 		VkPhysicalDevice	_physicalDevice;
 		VkDevice			_device;
+		MemoryAllocator		_memoryAllocator;
 
 		VkSurfaceKHR _surface;
 
@@ -51,35 +131,166 @@ namespace core
 		VkFormat _swapChainImageFormat;
 		VkExtent2D _swapChainExtent;
 
+		// when graphics and present families differ, exclusive images are released after the render pass
+		// and acquired by a pre-recorded command buffer per image on the present queue
+		bool _swapChainOwnershipTransfer = false;
+		VkCommandPool _presentCommandPool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> _presentCommandBuffers;
+		std::vector<VkSemaphore> _presentReadySemaphores;
+
+		// in headless mode these hold the offscreen render targets, one per frame in flight
 		std::vector<VkImage> _swapChainImages;
 		std::vector<VkImageView> _swapChainImageViews;
+		std::vector<MemoryAllocator::Allocation> _offscreenImageAllocations;
 
 		VkRenderPass _renderPass;
+		std::vector<char> _vertShaderCode;
+		std::vector<char> _fragShaderCode;
+		std::vector<char> _cullShaderCode;
+		std::vector<char> _objectCullShaderCode;
+		VkShaderModule _vertShaderModule;
+		VkShaderModule _fragShaderModule;
+		PipelineCache _pipelineCache;
 		VkPipelineLayout _pipelineLayout;
 		VkPipeline _graphicsPipeline;
 
+		struct Vertex {
+			glm::vec3 position;
+			glm::vec3 color;
+		};
+
+		typedef VertexFormat<
+			VertexAttribute<glm::vec3, VK_FORMAT_R32G32B32_SFLOAT>,
+			VertexAttribute<glm::vec3, VK_FORMAT_R32G32B32_SFLOAT>
+		> ColorVertexFormat;
+		static_assert(sizeof(Vertex) == ColorVertexFormat::stride, "Vertex does not match its format");
+
+		// half as large, the shader reads both formats as floats
+		struct QuantizedVertex {
+			glm::u16vec4 position;
+			uint32_t color;
+		};
+
+		typedef VertexFormat<
+			VertexAttribute<glm::u16vec4, VK_FORMAT_R16G16B16A16_SFLOAT>,
+			VertexAttribute<uint32_t, VK_FORMAT_R8G8B8A8_UNORM>
+		> QuantizedVertexFormat;
+		static_assert(sizeof(QuantizedVertex) == QuantizedVertexFormat::stride, "QuantizedVertex does not match its format");
+
+		VertexInputDescription _vertexInput;
+		Mesh _mesh;
+		MeshFile _meshFile;
+		std::vector<Meshlet> _meshlets;	// until the culler took them
+		ClusterCuller _clusterCuller;
+		bool _multiDrawIndirect = false;
+
+		// drawCount instances of the mesh on a grid as scene entities, in the order of the instance-rate
+		// vertex buffer of their transforms
+		Scene _scene;
+		glm::vec4 _meshSphere;
+		VkBuffer _objects = VK_NULL_HANDLE;
+		MemoryAllocator::Allocation _objectsMemory;
+		ObjectCuller _objectCuller;
+		PFN_vkCmdDrawIndexedIndirectCountAMD _drawIndirectCount = nullptr;
+		// world space bounding spheres of the objects for CPU culling, the visible ones of the frame being recorded
+		FrustumCuller _frustumCuller;
+		std::vector<uint32_t> _visibleObjects;
+		uint64_t _cpuVisibleObjects = 0;
+		double _cpuCullMilliseconds = 0.;
+		std::chrono::steady_clock::time_point _meshStreamStart;
+
+		// per frame, leaves the rest of the ring to other uploads while a mesh file streams in
+		static constexpr VkDeviceSize MESH_STREAM_BUDGET = 4 << 20;
+
 		std::vector<VkFramebuffer> _swapChainFramebuffers;
 
-		VkCommandPool _commandPool;
+		// one transient pool and primary buffer per frame in flight, reset and re-recorded every frame
+		std::vector<VkCommandPool> _commandPools;
 		std::vector<VkCommandBuffer> _commandBuffers;
+		CommandRecorder _commandRecorder;
+		// draws of the frame sorted by state, totals of its counters over the frames
+		RenderQueue _renderQueue;
+		uint32_t _renderPipeline = 0;
+		uint32_t _renderGeometry = 0;
+		RenderQueue::Stats _renderQueueTotals;
+		double _sortMilliseconds = 0.;
+		GpuProfiler _gpuProfiler;
+		double _recordMilliseconds = 0.;
+		double _maxRecordMilliseconds = 0.;
 
-		VkSemaphore _imageAvailableSemaphore;
-		VkSemaphore _renderFinishedSemaphore;
+		std::vector<VkSemaphore> _imageAvailableSemaphores;
+		std::vector<VkSemaphore> _renderFinishedSemaphores;
+		std::vector<VkFence> _inFlightFences;
+		std::vector<VkFence> _imagesInFlight;
+		size_t _currentFrame = 0;
+		uint64_t _frameNumber = 0;
+
+		FrameReadback _readback;
+
+		static constexpr uint UPLOAD_CHUNK_SIZE = 256;
+		UploadManager _uploads;
+
+		// uploads go to a dedicated queue when there is one, the frame's submit waits on its semaphore
+		VkQueue _uploadQueue = VK_NULL_HANDLE;
+		uint32_t _uploadFamily;
+		std::vector<VkCommandPool> _uploadCommandPools;
+		std::vector<VkCommandBuffer> _uploadCommandBuffers;
+		std::vector<VkSemaphore> _uploadSemaphores;
+		bool _uploadsPending = false;
+		VkBuffer _uploadTarget = VK_NULL_HANDLE;
+		MemoryAllocator::Allocation _uploadTargetMemory;
+
+		struct StartupStage {
+			const char* name;
+			uint thread;
+			double start;
+			double duration;
+		};
+
+		std::chrono::steady_clock::time_point _startTime;
+		std::vector<StartupStage> _startupStages;
+		std::mutex _startupMutex;
+		std::exception_ptr _startupError;
+		util::JobSystem::Counter _shaderCodeLoaded;
+
+		void runStage(const char* name, const std::function<void()>& function);
+		util::JobSystem::Task asyncStage(const char* name, const std::function<void()>& function);
+		void rethrowStartupError();
+		void logStartup();
 
 		void initWindow();
 		void initVulkan();
+		void loadShaderCode();
 		void createInstance();
 		void createSurface();
 		void pickPhysicalDevice();
 		void createLogicalDevice();
 		void createSwapChain();
+		void createPresentCommandBuffers();
+		void createOffscreenTargets();
 		void createImageViews();
 		void createRenderPass();
+		void createShaderModules();
 		void createGraphicsPipeline();
 		void createFramebuffers();
-		void createCommandPool();
+		void createCommandPools();
 		void createCommandBuffers();
-		void createSemaphores();
+		void recordCommandBuffer(uint32_t imageIndex);
+		void createSyncObjects();
+		void createReadback();
+		void createUploads();
+		void createMesh();
+		void loadMeshFile();
+		void createClusterCuller();
+		glm::vec4 objectTransform(uint index) const;
+		void createObjects();
+		void createObjectCuller();
+		void createRenderQueue();
+		static VertexInputDescription vertexInputDescription(const Settings& settings);
+		static std::vector<char> packVertices(const std::vector<Vertex>& vertices, const Settings& settings);
+		template<typename Format, typename VertexType>
+		static std::vector<char> layoutVertices(const std::vector<VertexType>& vertices, VertexLayout layout);
+		void streamUploads();
 
 		VkShaderModule createShaderModule(const std::vector<char>& code);
 
@@ -87,14 +298,24 @@ namespace core
 			int graphicsFamily = -1;
 			int presentFamily = -1;
 
+			// families without graphics (compute) or without graphics and compute (transfer), -1 when the device has none
+			int computeFamily = -1;
+			int transferFamily = -1;
+			// queues these families offer, only reported: uploads create and use one
+			uint computeQueueCount = 0;
+			uint transferQueueCount = 0;
+
 			bool isComplete() {
 				return graphicsFamily >= 0 && presentFamily >= 0;
 			}
 		};
 
+		QueueFamilyIndices _queueFamilyIndices;
+
 		bool isDeviceSuitable(VkPhysicalDevice);
 		QueueFamilyIndices findQueueFamilies(VkPhysicalDevice);
 		bool checkDeviceExtensionSupport(VkPhysicalDevice);
+		static bool hasDeviceExtension(VkPhysicalDevice device, const char* name);
 
 		struct SwapChainSupportDetails {
 			VkSurfaceCapabilitiesKHR _capabilities;
@@ -113,4 +334,4 @@ namespace core
 
 		static std::vector<char> readFile(const std::string& filename);
 	};
-}
+}
\ No newline at end of file
@@ -0,0 +1,932 @@
+#include "Benchmarks.h"
+#include "JobSystem.h"
+#include "TlsfAllocator.h"
+#include "VertexPacking.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+#include "FrustumCuller.h"
+#include "Bvh.h"
+#include "Scene.h"
+#include "TransformHierarchy.h"
+#include "RenderQueue.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cmath>
+#include <stdexcept>
+
+namespace core
+{
+	namespace
+	{
+		// the fastest of repetitions runs of function, in Period units of a second: std::milli, std::nano...
+		template<typename Period>
+		double fastest(int repetitions, const std::function<void()>& function)
+		{
+			double result = std::numeric_limits<double>::max();
+			for (int r = 0; r < repetitions; ++r) {
+				const auto start = std::chrono::steady_clock::now();
+				function();
+				const std::chrono::duration<double, Period> elapsed = std::chrono::steady_clock::now() - start;
+				result = std::min(result, elapsed.count());
+			}
+			return result;
+		}
+
+		// a sphere of size x size quads with its triangles in random order, the worst case for the vertex cache
+		void shuffledSphere(uint size, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+		{
+			positions.clear();
+			for (uint y = 0; y <= size; ++y)
+				for (uint x = 0; x <= size; ++x) {
+					const float theta = glm::pi<float>() * y / size, phi = glm::two_pi<float>() * x / size;
+					positions.push_back(glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+				}
+
+			// counterclockwise seen from outside
+			std::vector<std::array<uint32_t, 3>> triangles;
+			for (uint y = 0; y < size; ++y)
+				for (uint x = 0; x < size; ++x) {
+					const uint32_t corner = y * (size + 1) + x;
+					triangles.push_back({ corner, corner + 1, corner + size + 2 });
+					triangles.push_back({ corner, corner + size + 2, corner + size + 1 });
+				}
+			std::mt19937 random(1);
+			std::shuffle(triangles.begin(), triangles.end(), random);
+
+			indices.clear();
+			for (const auto& triangle : triangles)
+				indices.insert(indices.end(), triangle.begin(), triangle.end());
+		}
+	}
+
+	bool Benchmarks::jobs(uint taskCount, const App::Settings& settings)
+	{
+		// spawn overhead: empty tasks against one counter, the calling thread helps while it waits
+		{
+			util::JobSystem jobSystem;
+			jobSystem.init(settings.workerCount());
+			std::atomic<uint> executed { 0 };
+			const double spawn = fastest<std::nano>(5, [&] {
+				util::JobSystem::Counter counter;
+				for (uint i = 0; i < taskCount; ++i)
+					jobSystem.run([&executed] { executed.fetch_add(1, std::memory_order_relaxed); }, &counter);
+				jobSystem.wait(counter);
+			});
+			const util::JobSystem::Stats stats = jobSystem.stats();
+			REPORT(taskCount << " empty tasks: " << spawn / std::max(taskCount, 1u) << "ns per spawn and run on " << jobSystem.threadCount()
+				<< " threads, " << stats.stolen << " of " << stats.executed << " stolen")
+			if (executed != 5 * taskCount) {
+				REPORT("the job system ran " << executed << " tasks instead of " << 5 * taskCount)
+				return false;
+			}
+		}
+
+		// parallelFor scaling: the same work on 1, 2, 4... threads up to the configured count
+		const size_t elementCount = static_cast<size_t>(taskCount) * 16;
+		const auto work = [](std::vector<float>& values, size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				float value = static_cast<float>(i);
+				for (int k = 0; k < 16; ++k)
+					value = std::sqrt(value + k);
+				values[i] = value;
+			}
+		};
+		std::vector<float> reference(elementCount), values(elementCount);
+		work(reference, 0, elementCount);
+
+		std::vector<uint> threadCounts;
+		for (uint threads = 1; threads <= settings.workerCount(); threads *= 2)
+			threadCounts.push_back(threads);
+		threadCounts.push_back(settings.workerCount() + 1);
+
+		bool matches = true;
+		double serial = 0.;
+		for (const uint threads : threadCounts) {
+			util::JobSystem jobSystem;
+			jobSystem.init(threads - 1);
+			const double milliseconds = fastest<std::milli>(5, [&] {
+				jobSystem.parallelFor(elementCount, 4096, [&](size_t begin, size_t end) { work(values, begin, end); });
+			});
+			if (threads == 1)
+				serial = milliseconds;
+
+			const bool same = values == reference;
+			matches = matches && same;
+			REPORT("parallelFor over " << elementCount << " elements on " << threads << " threads: " << milliseconds << "ms, speedup "
+				<< serial / milliseconds << (same ? "" : ", DIFFERS FROM SERIAL"))
+			std::fill(values.begin(), values.end(), 0.f);
+		}
+
+		// dependency graph: layers of tasks, each one waits on the counter of a random earlier layer and spawns
+		// a child into its own layer. A task finding its dependency unfinished or running twice fails the check
+		constexpr uint LAYER_COUNT = 64;
+		const uint width = std::max(taskCount / (2 * LAYER_COUNT), 1u);
+		util::JobSystem jobSystem;
+		jobSystem.init(settings.workerCount());
+
+		std::vector<util::JobSystem::Counter> layers(LAYER_COUNT);
+		std::vector<std::atomic<uint>> finished(LAYER_COUNT);
+		std::atomic<uint> violations { 0 };
+		std::mt19937 random(1);
+		const double graph = fastest<std::milli>(1, [&] {
+			for (auto& count : finished)
+				count = 0;
+
+			for (uint layer = 0; layer < LAYER_COUNT; ++layer)
+				for (uint i = 0; i < width; ++i) {
+					const uint dependency = layer ? random() % layer : 0;
+					const util::JobSystem::Task task = [&, layer, dependency] {
+						if (layer && finished[dependency].load(std::memory_order_acquire) != 2 * width)
+							violations.fetch_add(1, std::memory_order_relaxed);
+						jobSystem.run([&finished, layer] { finished[layer].fetch_add(1, std::memory_order_release); }, &layers[layer]);
+						finished[layer].fetch_add(1, std::memory_order_release);
+					};
+					if (layer)
+						jobSystem.runAfter(layers[dependency], task, &layers[layer]);
+					else
+						jobSystem.run(task, &layers[layer]);
+				}
+
+			for (auto& layer : layers)
+				jobSystem.wait(layer);
+		});
+
+		uint total = 0;
+		for (const auto& count : finished)
+			total += count;
+		const bool ordered = !violations && total == 2 * width * LAYER_COUNT;
+		REPORT("dependency graph of " << LAYER_COUNT << " layers of " << width << " tasks and their children: " << graph << "ms, "
+			<< 1e6 * graph / (2 * width * LAYER_COUNT) << "ns per task" << (ordered ? "" : ", DEPENDENCIES VIOLATED"))
+
+		// exceptions: every range of a parallelFor still runs when some of them throw, the caller gets
+		// the first exception once they all finished, and a counter a task threw on can be waited on again
+		constexpr size_t GRAIN = 64;
+		const uint rangeCount = static_cast<uint>((elementCount + GRAIN - 1) / GRAIN);
+		std::atomic<uint> ranges { 0 };
+		bool rethrown = false;
+		try {
+			jobSystem.parallelFor(elementCount, GRAIN, [&](size_t begin, size_t) {
+				ranges.fetch_add(1, std::memory_order_relaxed);
+				if (begin % (GRAIN * 64) == 0)
+					throw std::runtime_error("range at " + std::to_string(begin));
+			});
+		}
+		catch (const std::runtime_error&) {
+			rethrown = true;
+		}
+		util::JobSystem::Counter counter;
+		jobSystem.run([] { throw std::runtime_error("task"); }, &counter);
+		bool waitRethrown = false;
+		try {
+			jobSystem.wait(counter);
+		}
+		catch (const std::runtime_error&) {
+			waitRethrown = true;
+		}
+		jobSystem.run([&ranges] { ranges.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		jobSystem.wait(counter);
+		const bool propagated = (rethrown || !elementCount) && waitRethrown && ranges == rangeCount + 1;
+		REPORT("throwing tasks: " << ranges << " of " << rangeCount + 1 << " ran, "
+			<< (propagated ? "exceptions rethrown" : "EXCEPTIONS LOST") << " to the waiting thread")
+
+		jobSystem.clean();
+		if (!matches || !ordered || !propagated)
+			REPORT("the job system does not match the serial reference, broke a dependency or lost an exception")
+		return matches && ordered && propagated;
+	}
+
+	bool Benchmarks::allocator(uint allocationCount)
+	{
+		// requests of 16 bytes to 64 KB spread evenly over the powers of two, aligned to 1 to 4 KB
+		std::mt19937 random(1);
+		std::uniform_real_distribution<double> sizeLog2(4., 16.);
+		std::uniform_int_distribution<int> alignmentLog2(0, 12);
+		const auto request = [&] {
+			return std::make_pair(static_cast<uint64_t>(std::exp2(sizeLog2(random))), 1ull << alignmentLog2(random));
+		};
+
+		// throughput: only offsets are handed out, so the range can be as large as every request together
+		std::vector<std::pair<uint64_t, uint64_t>> requests(allocationCount);
+		uint64_t total = 0;
+		for (auto& r : requests) {
+			r = request();
+			total += r.first + r.second;
+		}
+		std::vector<uint32_t> order(allocationCount);
+		std::iota(order.begin(), order.end(), 0u);
+		std::shuffle(order.begin(), order.end(), random);
+
+		std::vector<uint64_t> offsets(allocationCount);
+		double allocateTime = std::numeric_limits<double>::max(), freeTime = std::numeric_limits<double>::max();
+		for (int repetition = 0; repetition < 5; ++repetition) {
+			TlsfAllocator tlsf(total);
+			allocateTime = std::min(allocateTime, fastest<std::nano>(1, [&] {
+				for (uint i = 0; i < allocationCount; ++i)
+					offsets[i] = tlsf.allocate(requests[i].first, requests[i].second);
+			}));
+			freeTime = std::min(freeTime, fastest<std::nano>(1, [&] {
+				for (const uint32_t i : order)
+					tlsf.free(offsets[i]);
+			}));
+		}
+		REPORT(allocationCount << " allocations: " << allocateTime / std::max(allocationCount, 1u) << "ns per allocate, "
+			<< freeTime / std::max(allocationCount, 1u) << "ns per free in random order")
+
+		// correctness: random allocates and frees over a mocked heap of 4 MB. Every allocation marks its bytes, so an
+		// overlap, a misaligned or out of range offset shows, and the stats must agree with the live allocations
+		constexpr uint64_t HEAP_SIZE = 4 << 20;
+		std::vector<uint8_t> heap(HEAP_SIZE, 0);
+		TlsfAllocator tlsf(HEAP_SIZE);
+		std::vector<std::pair<uint64_t, uint64_t>> live;
+		uint64_t liveBytes = 0;
+		uint errors = 0, failures = 0;
+		const auto marked = [&heap](uint64_t offset, uint64_t size, uint8_t value) {
+			return std::all_of(heap.begin() + offset, heap.begin() + offset + size, [value](uint8_t byte) { return byte == value; });
+		};
+
+		for (uint step = 0; step < allocationCount; ++step) {
+			if (live.empty() || random() % 2) {
+				const auto r = request();
+				const uint64_t offset = tlsf.allocate(r.first, r.second);
+				if (offset == TlsfAllocator::INVALID_OFFSET) {
+					// a size class holds ranges within 1/16 of each other, so twice the padded size always fits
+					++failures;
+					errors += tlsf.stats().largestFreeRange >= 2 * (r.first + r.second);
+					continue;
+				}
+
+				if (offset % r.second || offset + r.first > HEAP_SIZE || !marked(offset, r.first, 0)) {
+					++errors;
+					continue;
+				}
+				std::fill(heap.begin() + offset, heap.begin() + offset + r.first, uint8_t(1));
+				live.emplace_back(offset, r.first);
+				liveBytes += r.first;
+			}
+			else {
+				const size_t index = random() % live.size();
+				const auto allocation = live[index];
+				live[index] = live.back();
+				live.pop_back();
+
+				errors += !marked(allocation.first, allocation.second, 1);
+				std::fill(heap.begin() + allocation.first, heap.begin() + allocation.first + allocation.second, uint8_t(0));
+				tlsf.free(allocation.first);
+				liveBytes -= allocation.second;
+
+				// a second free of the same offset is ignored
+				tlsf.free(allocation.first);
+			}
+
+			if (step % 1024 == 0) {
+				const TlsfAllocator::Stats stats = tlsf.stats();
+				errors += stats.used != liveBytes || stats.allocationCount != live.size();
+			}
+		}
+
+		const TlsfAllocator::Stats churned = tlsf.stats();
+		for (const auto& allocation : live)
+			tlsf.free(allocation.first);
+
+		// every neighbouring free range merged back into one
+		const TlsfAllocator::Stats empty = tlsf.stats();
+		errors += !tlsf.empty() || empty.used || empty.freeRangeCount != 1 || empty.largestFreeRange != HEAP_SIZE;
+
+		REPORT("mocked heap of " << HEAP_SIZE / 1024 << " KB after " << allocationCount << " random steps: " << live.size() << " allocations, "
+			<< churned.freeRangeCount << " free ranges, largest " << churned.largestFreeRange / 1024 << " KB of "
+			<< (churned.size - churned.used) / 1024 << " KB free, " << failures << " requests did not fit")
+
+		if (errors)
+			REPORT(errors << " TLSF allocator checks failed")
+		return !errors;
+	}
+
+	bool Benchmarks::vertexPacking(uint sampleCount)
+	{
+		// the decoders evaluate in float like the GPU does: absolute errors may pass their bound by a few float
+		// ulps of 1, which is the rounding of the decode and not of the encoding
+		const double slack = 4. * std::numeric_limits<float>::epsilon();
+		bool withinBounds = true;
+		const auto check = [&withinBounds](const char* name, double error, double bound, double tolerance) {
+			const bool within = error <= bound + tolerance;
+			withinBounds = withinBounds && within;
+			REPORT(name << ": max error " << error << ", documented bound " << bound << (within ? "" : ", EXCEEDED"))
+		};
+
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		std::uniform_real_distribution<float> signedUnit(-1.f, 1.f);
+		std::normal_distribution<float> gaussian;
+		// magnitudes spread evenly over the exponents of normal half floats, either sign
+		std::uniform_real_distribution<float> halfLog2(-14.f, 15.f);
+		const auto halfRange = [&] { return (random() % 2 ? 1.f : -1.f) * std::exp2(halfLog2(random)); };
+		const auto relative = [](double value, double decoded) { return std::abs(decoded - value) / std::abs(value); };
+
+		double positionError = 0.;
+		for (uint i = 0; i < sampleCount; ++i) {
+			const glm::vec3 position(halfRange(), halfRange(), halfRange());
+			const glm::vec3 decoded = VertexPacking::unpackPosition(VertexPacking::packPosition(position));
+			for (int c = 0; c < 3; ++c)
+				positionError = std::max(positionError, relative(position[c], decoded[c]));
+		}
+		check("position, relative", positionError, std::exp2(-11.), 0.);
+
+		// random directions, the axes and the diagonals the octahedron folds along
+		std::vector<glm::vec3> normals = { { 1.f, 0.f, 0.f }, { -1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, -1.f, 0.f },
+			{ 0.f, 0.f, 1.f }, { 0.f, 0.f, -1.f }, { 1.f, 1.f, 0.f }, { -1.f, 1.f, 0.f }, { 1.f, -1.f, 0.f }, { -1.f, -1.f, 0.f } };
+		for (uint i = 0; i < sampleCount; ++i)
+			normals.push_back(glm::vec3(gaussian(random), gaussian(random), gaussian(random)));
+		double normalError = 0.;
+		for (auto normal : normals) {
+			if (glm::length(normal) == 0.f)
+				continue;
+			normal = glm::normalize(normal);
+			const glm::dvec3 a(normal), b(VertexPacking::unpackNormal(VertexPacking::packNormal(normal)));
+			normalError = std::max(normalError, std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b)));
+		}
+		check("normal, degrees", glm::degrees(normalError), .005, 0.);
+
+		double texCoordError = 0., tiledTexCoordError = 0.;
+		for (uint i = 0; i < sampleCount; ++i) {
+			const glm::vec2 texCoord(unit(random), unit(random));
+			const glm::vec2 decoded = VertexPacking::unpackTexCoord(VertexPacking::packTexCoord(texCoord));
+			const glm::vec2 tiled(halfRange(), halfRange());
+			const glm::vec2 tiledDecoded = VertexPacking::unpackTexCoord(VertexPacking::packTexCoord(tiled));
+			for (int c = 0; c < 2; ++c) {
+				texCoordError = std::max(texCoordError, std::abs(static_cast<double>(decoded[c]) - texCoord[c]));
+				tiledTexCoordError = std::max(tiledTexCoordError, relative(tiled[c], tiledDecoded[c]));
+			}
+		}
+		check("texture coordinate in [0, 1], absolute", texCoordError, std::exp2(-12.), slack);
+		check("texture coordinate, relative", tiledTexCoordError, std::exp2(-11.), 0.);
+
+		double tangentError = 0.;
+		bool signs = true;
+		for (uint i = 0; i < sampleCount + 2; ++i) {
+			// the extremes first, both signs
+			const glm::vec4 tangent = i < 2 ? glm::vec4(glm::vec3(i ? -1.f : 1.f), i ? -1.f : 1.f)
+				: glm::vec4(signedUnit(random), signedUnit(random), signedUnit(random), random() % 2 ? 1.f : -1.f);
+			const glm::vec4 decoded = VertexPacking::unpackTangent(VertexPacking::packTangent(tangent));
+			for (int c = 0; c < 3; ++c)
+				tangentError = std::max(tangentError, std::abs(static_cast<double>(decoded[c]) - tangent[c]));
+			signs = signs && decoded.w == tangent.w;
+		}
+		check("tangent xyz, absolute", tangentError, 1. / 1023., slack);
+		check("tangent sign, absolute", signs ? 0. : 2., 0., 0.);
+
+		double colorError = 0.;
+		for (uint i = 0; i < sampleCount + 2; ++i) {
+			const glm::vec4 color = i < 2 ? glm::vec4(static_cast<float>(i))
+				: glm::vec4(unit(random), unit(random), unit(random), unit(random));
+			const glm::vec4 decoded = VertexPacking::unpackColor(VertexPacking::packColor(color));
+			for (int c = 0; c < 4; ++c)
+				colorError = std::max(colorError, std::abs(static_cast<double>(decoded[c]) - color[c]));
+		}
+		check("color, absolute", colorError, 1. / 510., slack);
+
+		if (!withinBounds)
+			REPORT("a vertex packing error exceeds the bound VertexPacking.h documents")
+		return withinBounds;
+	}
+
+	bool Benchmarks::meshOptimizer(uint size, const App::Settings& settings)
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> shuffled;
+		shuffledSphere(size, positions, shuffled);
+		const uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+
+		// the converter's passes in its order: triangles for the cache and overdraw, then vertices for fetch. ids
+		// follows the vertices through the remap, so triangles can be compared by the vertices they had before
+		struct Optimized {
+			std::vector<uint32_t> indices;
+			std::vector<glm::vec3> positions;
+			std::vector<uint32_t> ids;
+		};
+		const auto optimize = [&](Optimized& mesh) {
+			mesh.indices = shuffled;
+			mesh.positions = positions;
+			mesh.ids.resize(vertexCount);
+			std::iota(mesh.ids.begin(), mesh.ids.end(), 0u);
+
+			MeshOptimizer::optimizeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), vertexCount);
+			uint32_t usedCount;
+			const std::vector<uint32_t> remap = MeshOptimizer::optimizeVertexFetch(mesh.indices.data(), mesh.indices.size(), vertexCount, usedCount);
+			MeshOptimizer::remapVertices(mesh.positions, remap, usedCount);
+			MeshOptimizer::remapVertices(mesh.ids, remap, usedCount);
+		};
+
+		Optimized reference;
+		const double milliseconds = fastest<std::milli>(3, [&] { optimize(reference); });
+		const MeshOptimizer::CacheStats before = MeshOptimizer::analyzeVertexCache(shuffled.data(), shuffled.size(), vertexCount);
+		const MeshOptimizer::CacheStats after = MeshOptimizer::analyzeVertexCache(reference.indices.data(), reference.indices.size(),
+			static_cast<uint32_t>(reference.positions.size()));
+		// a mesh whose vertices all fit in the cache has nothing to gain
+		const bool improved = after.acmr < before.acmr || vertexCount <= MeshOptimizer::DEFAULT_CACHE_SIZE;
+		REPORT("sphere of " << vertexCount << " vertices, " << shuffled.size() / 3 << " shuffled triangles: optimized in " << milliseconds
+			<< "ms, ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr
+			<< (improved ? "" : ", NOT IMPROVED"))
+
+		// every triangle once, as the same vertices in the same winding: rotated to start at its smallest id, then sorted
+		const auto triangles = [](const std::vector<uint32_t>& indices, const uint32_t* ids) {
+			std::vector<std::array<uint32_t, 3>> result(indices.size() / 3);
+			for (size_t t = 0; t < result.size(); ++t) {
+				auto& triangle = result[t];
+				for (int k = 0; k < 3; ++k)
+					triangle[k] = ids ? ids[indices[t * 3 + k]] : indices[t * 3 + k];
+				std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+			}
+			std::sort(result.begin(), result.end());
+			return result;
+		};
+		bool preserved = triangles(reference.indices, reference.ids.data()) == triangles(shuffled, nullptr);
+		for (size_t i = 0; i < reference.positions.size(); ++i)
+			preserved = preserved && reference.positions[i] == positions[reference.ids[i]];
+		REPORT("  " << reference.positions.size() << " vertices kept, triangles " << (preserved ? "preserved" : "CHANGED"))
+
+		// the converter optimizes submeshes on the job system: the result must not depend on the thread
+		util::JobSystem jobSystem;
+		jobSystem.init(settings.workerCount());
+		std::vector<Optimized> runs(jobSystem.threadCount() + 1);
+		jobSystem.parallelFor(runs.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				optimize(runs[i]);
+		});
+		jobSystem.clean();
+
+		bool deterministic = true;
+		for (const auto& run : runs)
+			deterministic = deterministic && run.indices == reference.indices && run.ids == reference.ids;
+		REPORT("  " << runs.size() << " runs in parallel " << (deterministic ? "match" : "DIFFER FROM") << " the first one")
+
+		if (!improved || !preserved || !deterministic)
+			REPORT("the mesh optimizer did not improve the vertex cache, changed the triangles or is not deterministic")
+		return improved && preserved && deterministic;
+	}
+
+	bool Benchmarks::meshlets(uint size)
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> shuffled;
+		shuffledSphere(size, positions, shuffled);
+		const uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+		std::vector<uint32_t> optimized = shuffled;
+		MeshOptimizer::optimizeVertexCache(optimized.data(), optimized.size(), vertexCount);
+
+		// cameras around the sphere, the cone test is the one of ClusterCulling.comp
+		std::mt19937 random(1);
+		std::normal_distribution<float> gaussian;
+		std::vector<glm::vec3> cameras(64);
+		for (auto& camera : cameras)
+			camera = 3.f * glm::normalize(glm::vec3(gaussian(random), gaussian(random), gaussian(random)) + glm::vec3(1e-6f));
+
+		// built as a submesh would be, at an offset into the mesh's index buffer
+		constexpr uint32_t FIRST_INDEX = 300;
+		uint errors = 0;
+		for (const auto* indices : { &shuffled, &optimized }) {
+			std::vector<Meshlet> meshlets;
+			const double milliseconds = fastest<std::milli>(3, [&] {
+				meshlets.clear();
+				MeshletBuilder::build(indices->data(), indices->size(), positions.data(), vertexCount, FIRST_INDEX, meshlets);
+			});
+
+			// the ranges follow each other without a gap and cover every index
+			uint32_t next = FIRST_INDEX;
+			size_t vertexTotal = 0, coneTests = 0, coneCulls = 0;
+			for (const auto& meshlet : meshlets) {
+				const uint32_t* first = indices->data() + meshlet.firstIndex - FIRST_INDEX;
+				errors += meshlet.firstIndex != next || !meshlet.indexCount || meshlet.indexCount % 3
+					|| meshlet.indexCount / 3 > Meshlet::MAX_TRIANGLES || meshlet.vertexCount > Meshlet::MAX_VERTICES;
+				next = meshlet.firstIndex + meshlet.indexCount;
+				if (next > FIRST_INDEX + indices->size())
+					break;
+
+				std::vector<uint32_t> vertices(first, first + meshlet.indexCount);
+				std::sort(vertices.begin(), vertices.end());
+				errors += std::unique(vertices.begin(), vertices.end()) - vertices.begin() != meshlet.vertexCount;
+				vertexTotal += meshlet.vertexCount;
+				for (const uint32_t vertex : vertices)
+					errors += glm::length(positions[vertex] - meshlet.center) > meshlet.radius * 1.0001f + 1e-6f;
+
+				// a camera the cone culls sees the back of every triangle
+				if (meshlet.coneCutoff > 1.f)
+					continue;
+				for (const auto& camera : cameras) {
+					++coneTests;
+					if (glm::dot(glm::normalize(meshlet.coneApex - camera), meshlet.coneAxis) < meshlet.coneCutoff)
+						continue;
+					++coneCulls;
+					for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+						const glm::vec3& p0 = positions[first[i]];
+						const glm::vec3 normal = glm::cross(positions[first[i + 1]] - p0, positions[first[i + 2]] - p0);
+						if (glm::length(normal) > 0.f)
+							errors += glm::dot(camera - p0, glm::normalize(normal)) > 1e-4f;
+					}
+				}
+			}
+			errors += next != FIRST_INDEX + indices->size();
+
+			REPORT((indices == &shuffled ? "shuffled" : "cache optimized") << " triangles: " << meshlets.size() << " meshlets in "
+				<< milliseconds << "ms, " << static_cast<double>(vertexTotal) / meshlets.size() << " vertices and "
+				<< indices->size() / 3. / meshlets.size() << " triangles on average, " << coneCulls << " of " << coneTests
+				<< " cone tests culled")
+		}
+
+		if (errors)
+			REPORT(errors << " meshlet checks failed: limits, index coverage, bounds or cones")
+		return !errors;
+	}
+
+	bool Benchmarks::culling(uint objectCount, const App::Settings& settings)
+	{
+		util::JobSystem jobSystem;
+		jobSystem.init(settings.workerCount());
+
+		// spheres scattered through a cube around a camera looking into it, roughly a third end up visible
+		FrustumCuller culler;
+		culler.reserve(objectCount);
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> position(-100.f, 100.f);
+		std::uniform_real_distribution<float> radius(.1f, 2.f);
+		for (uint i = 0; i < objectCount; ++i) {
+			const float x = position(random), y = position(random), z = position(random);
+			culler.add(glm::vec4(x, y, z, radius(random)));
+		}
+
+		// Vulkan clip space: y down, depth from 0 to 1
+		const glm::mat4 clip(1.f, 0.f, 0.f, 0.f, 0.f, -1.f, 0.f, 0.f, 0.f, 0.f, .5f, 0.f, 0.f, 0.f, .5f, 1.f);
+		const glm::mat4 viewProjection = clip * glm::perspective(glm::radians(60.f), 16.f / 9.f, .1f, 150.f)
+			* glm::lookAt(glm::vec3(0.f, 0.f, -100.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+		glm::vec4 planes[6];
+		FrustumCuller::extractPlanes(viewProjection, planes);
+
+		std::vector<uint32_t> reference, visible;
+		const std::function<void()> paths[] = {
+			[&] { culler.cullScalar(planes, reference); },
+			[&] { culler.cull(planes, visible); },
+			[&] { culler.cull(planes, visible, jobSystem); }
+		};
+		const char* names[] = { "scalar", "SIMD", "SIMD parallel" };
+
+		bool matches = true;
+		for (int path = 0; path < 3; ++path) {
+			const double best = fastest<std::nano>(20, paths[path]);
+
+			const bool same = !path || visible == reference;
+			matches = matches && same;
+			REPORT("culling " << objectCount << " objects, " << names[path] << ": " << objectCount / best << " objects/ns, "
+				<< (path ? visible.size() : reference.size()) << " visible" << (same ? "" : ", DIFFERS FROM SCALAR"))
+		}
+
+		REPORT("SIMD width " << FrustumCuller::WIDTH << ", " << jobSystem.threadCount() << " threads")
+		jobSystem.clean();
+		if (!matches)
+			REPORT("SIMD culling does not match the scalar reference")
+		return matches;
+	}
+
+	bool Benchmarks::bvh(uint maxObjectCount, const App::Settings& settings)
+	{
+		util::JobSystem jobSystem;
+		jobSystem.init(settings.workerCount());
+
+		// a camera at the center of the world looking along +z, as far as the benchmark of FrustumCuller
+		const glm::mat4 clip(1.f, 0.f, 0.f, 0.f, 0.f, -1.f, 0.f, 0.f, 0.f, 0.f, .5f, 0.f, 0.f, 0.f, .5f, 1.f);
+		const glm::mat4 viewProjection = clip * glm::perspective(glm::radians(60.f), 16.f / 9.f, .1f, 150.f)
+			* glm::lookAt(glm::vec3(0.f), glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, 1.f, 0.f));
+		glm::vec4 planes[6];
+		FrustumCuller::extractPlanes(viewProjection, planes);
+
+		bool matches = true;
+		for (uint objectCount = std::min(10000u, maxObjectCount); objectCount <= maxObjectCount; objectCount *= 10) {
+			// constant density: the world grows with the object count, the frustum sees about as many objects
+			const float side = 200.f * std::cbrt(objectCount / 10000.f);
+			std::mt19937 random(1);
+			std::uniform_real_distribution<float> position(-.5f * side, .5f * side);
+			std::uniform_real_distribution<float> extent(.1f, 1.f);
+			std::vector<Bvh::Aabb> bounds(objectCount);
+			for (auto& box : bounds) {
+				const float x = position(random), y = position(random), z = position(random);
+				const float ex = extent(random), ey = extent(random), ez = extent(random);
+				box = { glm::vec3(x - ex, y - ey, z - ez), glm::vec3(x + ex, y + ey, z + ez) };
+			}
+
+			Bvh bvh;
+			const double serialBuild = fastest<std::milli>(1, [&] { bvh.build(bounds.data(), bounds.size()); });
+			const double parallelBuild = fastest<std::milli>(1, [&] { bvh.build(bounds.data(), bounds.size(), &jobSystem); });
+			REPORT(objectCount << " objects: build " << serialBuild << "ms on one thread, " << parallelBuild << "ms on "
+				<< jobSystem.threadCount() << ", " << bvh.nodes().size() << " nodes, SAH cost " << bvh.cost())
+
+			std::vector<uint32_t> visible, reference;
+			const double bvhCull = fastest<std::milli>(5, [&] { bvh.cull(planes, visible); });
+			const double bruteForceCull = fastest<std::milli>(5, [&] {
+				reference.clear();
+				for (uint32_t i = 0; i < objectCount; ++i)
+					if (!Bvh::culled(planes, bounds[i]))
+						reference.push_back(i);
+			});
+			std::sort(visible.begin(), visible.end());
+			const bool same = visible == reference;
+			matches = matches && same;
+			REPORT("  frustum culling: " << bvhCull << "ms, brute force " << bruteForceCull << "ms, " << reference.size()
+				<< " visible" << (same ? "" : ", DIFFERS FROM BRUTE FORCE"))
+
+			// picking rays and range queries from random points of the world
+			constexpr int QUERY_COUNT = 1000;
+			std::vector<glm::vec3> points(2 * QUERY_COUNT);
+			for (auto& point : points)
+				point = glm::vec3(position(random), position(random), position(random));
+			uint hits = 0;
+			const double rays = fastest<std::milli>(3, [&] {
+				hits = 0;
+				Bvh::Hit hit;
+				for (int q = 0; q < QUERY_COUNT; ++q)
+					hits += bvh.raycast(points[2 * q], points[2 * q + 1] - points[2 * q], 1.f, hit);
+			});
+			size_t found = 0;
+			const double ranges = fastest<std::milli>(3, [&] {
+				found = 0;
+				for (int q = 0; q < QUERY_COUNT; ++q)
+					found += bvh.query({ points[q] - glm::vec3(10.f), points[q] + glm::vec3(10.f) }, visible);
+			});
+			REPORT("  " << 1000. * rays / QUERY_COUNT << "us per ray (" << hits << " of " << QUERY_COUNT << " hit), "
+				<< 1000. * ranges / QUERY_COUNT << "us per range query (" << found / QUERY_COUNT << " objects on average)")
+
+			// every frame 1% of the objects move a little
+			std::uniform_real_distribution<float> step(-1.f, 1.f);
+			double refitTime = 0.;
+			uint rebuilds = 0;
+			constexpr int FRAME_COUNT = 10;
+			for (int frame = 0; frame < FRAME_COUNT; ++frame) {
+				for (uint i = 0; i < objectCount / 100; ++i) {
+					const uint32_t index = random() % objectCount;
+					const glm::vec3 offset(step(random), step(random), step(random));
+					bounds[index].min += offset;
+					bounds[index].max += offset;
+					bvh.update(index, bounds[index]);
+				}
+				refitTime += fastest<std::milli>(1, [&] { rebuilds += bvh.refit(&jobSystem); });
+			}
+			REPORT("  refit after moving 1% of the objects: " << refitTime / FRAME_COUNT << "ms, " << rebuilds
+				<< " rebuilds, SAH cost " << bvh.cost())
+
+			if (objectCount > std::numeric_limits<uint>::max() / 10)
+				break;
+		}
+
+		jobSystem.clean();
+		if (!matches)
+			REPORT("BVH culling does not match brute force culling")
+		return matches;
+	}
+
+	bool Benchmarks::scene(uint entityCount, const App::Settings& settings)
+	{
+		util::JobSystem jobSystem;
+		jobSystem.init(settings.workerCount());
+
+		struct Position {
+			glm::vec3 value;
+		};
+		struct Velocity {
+			glm::vec3 value;
+		};
+		struct Health {
+			float value;
+		};
+
+		// the baseline: one heap object per entity, updated through a virtual call
+		struct Object {
+			virtual ~Object() = default;
+			virtual void update(float dt) = 0;
+		};
+		struct MovingObject : Object {
+			glm::vec3 position;
+			glm::vec3 velocity;
+			float health = 100.f;
+			void update(float dt) override { position += velocity * dt; }
+		};
+
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> value(-1.f, 1.f);
+		const float dt = 1.f / 60.f;
+
+		// every fourth entity has health as well, so queries cover two archetypes
+		Scene scene;
+		std::vector<Entity> entities(entityCount);
+		const double create = fastest<std::nano>(1, [&] {
+			scene.clear();
+			for (uint i = 0; i < entityCount; ++i) {
+				const Position position = { glm::vec3(value(random), value(random), value(random)) };
+				const Velocity velocity = { glm::vec3(value(random), value(random), value(random)) };
+				entities[i] = i % 4 ? scene.create(position, velocity) : scene.create(position, velocity, Health{ 100.f });
+			}
+		});
+
+		std::vector<std::unique_ptr<Object>> objects;
+		const double createObjects = fastest<std::nano>(1, [&] {
+			objects.clear();
+			for (uint i = 0; i < entityCount; ++i) {
+				auto object = std::make_unique<MovingObject>();
+				object->position = glm::vec3(value(random), value(random), value(random));
+				object->velocity = glm::vec3(value(random), value(random), value(random));
+				objects.push_back(std::move(object));
+			}
+		});
+		REPORT(entityCount << " entities in " << scene.chunkCount() << " chunks of " << Scene::CHUNK_SIZE / 1024 << " KB: create "
+			<< create / entityCount << "ns per entity, " << createObjects / entityCount << "ns per heap object")
+
+		const double virtualUpdate = fastest<std::nano>(5, [&] {
+			for (auto& object : objects)
+				object->update(dt);
+		});
+		const double eachUpdate = fastest<std::nano>(5, [&] {
+			scene.each<Position, const Velocity>([dt](Entity, Position& position, const Velocity& velocity) {
+				position.value += velocity.value * dt;
+			});
+		});
+		const double chunkUpdate = fastest<std::nano>(5, [&] {
+			scene.forEachChunk<Position, const Velocity>([dt](const Entity*, size_t count, Position* positions, const Velocity* velocities) {
+				for (size_t i = 0; i < count; ++i)
+					positions[i].value += velocities[i].value * dt;
+			});
+		});
+		const double parallelUpdate = fastest<std::nano>(5, [&] {
+			scene.parallelForEachChunk<Position, const Velocity>(jobSystem,
+				[dt](const Entity*, size_t count, Position* positions, const Velocity* velocities) {
+					for (size_t i = 0; i < count; ++i)
+						positions[i].value += velocities[i].value * dt;
+				});
+		});
+		REPORT("update throughput: virtual calls " << entityCount / virtualUpdate << ", each " << entityCount / eachUpdate
+			<< ", chunks " << entityCount / chunkUpdate << ", parallel chunks " << entityCount / parallelUpdate << " entities/ns on "
+			<< jobSystem.threadCount() << " threads")
+
+		// churn: a tenth of the entities die and as many are born, in rounds
+		constexpr int ROUND_COUNT = 10;
+		const uint churnCount = std::max(entityCount / 10, 1u);
+		double churn = 0.;
+		for (int round = 0; round < ROUND_COUNT && entityCount; ++round)
+			churn += fastest<std::nano>(1, [&] {
+				for (uint i = 0; i < churnCount; ++i) {
+					const uint index = random() % entityCount;
+					scene.destroy(entities[index]);
+					entities[index] = index % 4 ? scene.create(Position{}, Velocity{}) : scene.create(Position{}, Velocity{}, Health{ 100.f });
+				}
+			});
+		REPORT("churn: " << churn / (2. * churnCount * ROUND_COUNT) << "ns per create or destroy, "
+			<< scene.archetypeCount() << " archetypes, " << scene.chunkCount() << " chunks")
+
+		bool consistent = scene.size() == entityCount && scene.count<Position, Velocity>() == entityCount
+			&& scene.count<Health>() == (entityCount + 3) / 4;
+		for (const Entity entity : entities)
+			consistent = consistent && scene.alive(entity);
+
+		jobSystem.clean();
+		if (!consistent)
+			REPORT("scene lost track of its entities")
+		return consistent;
+	}
+
+	bool Benchmarks::transforms(uint nodeCount, const App::Settings& settings)
+	{
+		util::JobSystem jobSystem;
+		jobSystem.init(settings.workerCount());
+
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> value(-1.f, 1.f);
+		const auto randomTransform = [&random, &value] {
+			const glm::vec3 axis = glm::normalize(glm::vec3(value(random), value(random), value(random) + 2.f));
+			return glm::rotate(glm::translate(glm::mat4(1.f), glm::vec3(value(random), value(random), value(random))), value(random), axis);
+		};
+
+		// 64 roots with 8 children per node, added breadth first: depth grows with log8 of the count
+		constexpr uint ROOT_COUNT = 64;
+		TransformHierarchy hierarchy;
+		std::vector<uint32_t> parents(nodeCount);
+		std::vector<glm::mat4> locals(nodeCount);
+		for (uint i = 0; i < nodeCount; ++i) {
+			parents[i] = i < ROOT_COUNT ? TransformHierarchy::NONE : (i - ROOT_COUNT) / 8;
+			locals[i] = randomTransform();
+			hierarchy.add(parents[i], locals[i]);
+		}
+		hierarchy.update(&jobSystem);
+		REPORT(nodeCount << " nodes over " << hierarchy.levelCount() << " levels, " << jobSystem.threadCount() << " threads")
+
+		bool matches = true;
+		for (const double share : { .01, .1, 1. }) {
+			const uint dirtyCount = static_cast<uint>(nodeCount * share);
+			double milliseconds[2];
+			for (int parallel = 0; parallel < 2; ++parallel) {
+				for (uint i = 0; i < dirtyCount; ++i) {
+					// every node once for 100%, random ones below
+					const uint node = share < 1. ? random() % nodeCount : i;
+					locals[node] = randomTransform();
+					hierarchy.setLocal(node, locals[node]);
+				}
+
+				milliseconds[parallel] = fastest<std::milli>(1, [&] { hierarchy.update(parallel ? &jobSystem : nullptr); });
+			}
+
+			// reference: every world transform from scratch with glm, parents come first
+			std::vector<glm::mat4> worlds(nodeCount);
+			float error = 0.f;
+			for (uint i = 0; i < nodeCount; ++i) {
+				worlds[i] = parents[i] == TransformHierarchy::NONE ? locals[i] : worlds[parents[i]] * locals[i];
+				for (int column = 0; column < 4; ++column) {
+					const glm::vec4 difference = glm::abs(worlds[i][column] - hierarchy.world(i)[column]);
+					error = std::max(error, std::max(std::max(difference.x, difference.y), std::max(difference.z, difference.w)));
+				}
+			}
+			const bool close = error < 1e-3f;
+			matches = matches && close;
+
+			REPORT("  " << 100. * share << "% dirty: " << milliseconds[0] << "ms on one thread, " << milliseconds[1] << "ms in parallel, "
+				<< hierarchy.updatedCount() << " world transforms recomputed, max error " << error << (close ? "" : ", TOO LARGE"))
+		}
+
+		jobSystem.clean();
+		if (!matches)
+			REPORT("transform hierarchy does not match the glm reference")
+		return matches;
+	}
+
+	bool Benchmarks::renderQueue(uint drawCount, const App::Settings& settings)
+	{
+		util::JobSystem jobSystem;
+		jobSystem.init(settings.workerCount());
+
+		// states are only counted, never bound: null handles do
+		constexpr uint32_t PIPELINE_COUNT = 32, MATERIAL_COUNT = 512, GEOMETRY_COUNT = 64;
+		RenderQueue queue;
+		for (uint32_t i = 0; i < PIPELINE_COUNT; ++i)
+			queue.addPipeline(VK_NULL_HANDLE, VK_NULL_HANDLE);
+		for (uint32_t i = 0; i < MATERIAL_COUNT; ++i)
+			queue.addMaterial(VK_NULL_HANDLE);
+		for (uint32_t i = 0; i < GEOMETRY_COUNT; ++i)
+			queue.addGeometry(nullptr);
+		queue.reserve(drawCount);
+
+		// the same draws in random order for every run, two passes, a quarter without material
+		const auto fill = [&queue, drawCount] {
+			queue.clear();
+			std::mt19937 random(1);
+			std::uniform_real_distribution<float> depth(0.f, 1.f);
+			for (uint i = 0; i < drawCount; ++i) {
+				const uint32_t pass = random() % 2;
+				const uint32_t pipeline = random() % PIPELINE_COUNT;
+				const uint32_t material = random() % 4 ? random() % MATERIAL_COUNT : RenderQueue::NONE;
+				const uint32_t geometry = random() % GEOMETRY_COUNT;
+				queue.push(pass, depth(random), { pipeline, material, geometry, 0, 3, 0, i, 1 });
+			}
+		};
+
+		fill();
+		const RenderQueue::Stats unsorted = queue.record(VK_NULL_HANDLE, 0, drawCount);
+		std::vector<std::pair<uint64_t, uint32_t>> reference(drawCount);
+		for (uint i = 0; i < drawCount; ++i)
+			reference[i] = { queue.key(i), queue.command(i) };
+
+		const double referenceTime = fastest<std::milli>(1, [&reference] {
+			std::stable_sort(reference.begin(), reference.end(), [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) {
+				return a.first < b.first;
+			});
+		});
+
+		bool matches = true;
+		double sortTimes[2];
+		for (int parallel = 0; parallel < 2; ++parallel) {
+			fill();
+			sortTimes[parallel] = fastest<std::milli>(1, [&] { queue.sort(parallel ? &jobSystem : nullptr); });
+
+			for (uint i = 0; i < drawCount && matches; ++i)
+				matches = queue.key(i) == reference[i].first && queue.command(i) == reference[i].second;
+		}
+		const RenderQueue::Stats sorted = queue.record(VK_NULL_HANDLE, 0, drawCount);
+
+		REPORT(drawCount << " draws sorted in " << sortTimes[0] << "ms on one thread, " << sortTimes[1] << "ms on "
+			<< jobSystem.threadCount() << ", std::stable_sort " << referenceTime << "ms" << (matches ? "" : ", ORDER DIFFERS"))
+		REPORT("  submission order: " << unsorted.pipelineBinds << " pipeline, " << unsorted.materialBinds << " material, "
+			<< unsorted.geometryBinds << " geometry binds")
+		REPORT("  sorted: " << sorted.pipelineBinds << " pipeline, " << sorted.materialBinds << " material, "
+			<< sorted.geometryBinds << " geometry binds, " << sorted.skippedBinds << " redundant binds skipped")
+
+		queue.clean();
+		jobSystem.clean();
+		if (!matches)
+			REPORT("render queue order does not match std::stable_sort")
+		return matches;
+	}
+}
\ No newline at end of file
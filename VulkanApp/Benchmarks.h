@@ -0,0 +1,44 @@
+#pragma once
+
+#include "App.h"
+
+namespace core
+{
+	// CPU microbenchmarks selected on the command line, no device needed. Each one checks its
+	// results against a plain reference and fails if they disagree. Results are printed with
+	// REPORT, so they show in release builds where logging is compiled out.
+	namespace Benchmarks
+	{
+		// runs taskCount empty tasks, a parallelFor on 1, 2, 4... threads up to settings.workerCount() + 1
+		// and a dependency graph of taskCount tasks, fails if a result or a dependency order is wrong or if
+		// an exception thrown by a task does not reach the waiting thread
+		bool jobs(uint taskCount, const App::Settings& settings);
+		// allocates and frees allocationCount random requests with the TLSF allocator and reports the time per
+		// call, then runs as many random steps over a mocked heap, fails on overlaps, misalignment or wrong stats
+		bool allocator(uint allocationCount);
+		// round-trips sampleCount random inputs, plus the edge cases, through every encoder of VertexPacking and
+		// its decoder, reports the largest errors and fails if one exceeds the bound documented next to the encoder
+		bool vertexPacking(uint sampleCount);
+		// optimizes a sphere of size x size quads with shuffled triangles like the converter does, serially and on the job
+		// system, fails if ACMR does not improve, if the triangles change or if two runs differ
+		bool meshOptimizer(uint size, const App::Settings& settings);
+		// cuts a sphere of size x size quads into meshlets, before and after vertex cache optimization, fails on meshlets
+		// over the limits, on gaps or overlaps in their index ranges, on spheres missing a vertex and on cones culling a front face
+		bool meshlets(uint size);
+		// culls objectCount random spheres with the scalar, SIMD and parallel paths of FrustumCuller
+		// and reports objects per nanosecond, fails if a path disagrees with the scalar one
+		bool culling(uint objectCount, const App::Settings& settings);
+		// builds, culls, picks, queries and refits BVHs of 10K, 100K... up to maxObjectCount random boxes
+		// and reports the times next to brute force culling, fails if the two disagree
+		bool bvh(uint maxObjectCount, const App::Settings& settings);
+		// creates, iterates and churns entityCount entities of the Scene next to heap objects updated
+		// through virtual calls, reports entities per nanosecond and nanoseconds per create and destroy
+		bool scene(uint entityCount, const App::Settings& settings);
+		// updates a hierarchy of nodeCount transforms with 1%, 10% and 100% of them changed, on one thread and
+		// in parallel, fails if the world transforms stray from a plain glm computation
+		bool transforms(uint nodeCount, const App::Settings& settings);
+		// sorts drawCount random draws over 32 pipelines, 512 materials and 64 geometries with the render
+		// queue, reports the sort times and the binds before and after, fails if the order differs from std::stable_sort
+		bool renderQueue(uint drawCount, const App::Settings& settings);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,474 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace core
+{
+	namespace
+	{
+		// the cost of visiting an inner node relative to testing one primitive
+		constexpr float TRAVERSAL_COST = 1.f;
+
+		Bvh::Aabb emptyBox()
+		{
+			const float max = std::numeric_limits<float>::max();
+			return { glm::vec3(max), glm::vec3(-max) };
+		}
+
+		void grow(Bvh::Aabb& box, const Bvh::Aabb& other)
+		{
+			box.min = glm::min(box.min, other.min);
+			box.max = glm::max(box.max, other.max);
+		}
+
+		void grow(Bvh::Aabb& box, const glm::vec3& point)
+		{
+			box.min = glm::min(box.min, point);
+			box.max = glm::max(box.max, point);
+		}
+
+		float area(const glm::vec3& min, const glm::vec3& max)
+		{
+			const glm::vec3 extent = glm::max(max - min, glm::vec3(0.f));
+			return 2.f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+		}
+
+		float area(const Bvh::Aabb& box)
+		{
+			return area(box.min, box.max);
+		}
+
+		// twice the center, the factor does not matter for binning
+		glm::vec3 centroid(const Bvh::Aabb& box)
+		{
+			return box.min + box.max;
+		}
+
+		// outside: the corner furthest along the normal is behind the plane. Inside: the nearest
+		// one is in front. The sums are monotonic in the corner, so a box inside a culled node is
+		// culled and a box inside a node in front of a plane is in front as well
+		bool outside(const glm::vec4& plane, const glm::vec3& min, const glm::vec3& max)
+		{
+			const glm::vec3 corner(plane.x >= 0.f ? max.x : min.x, plane.y >= 0.f ? max.y : min.y, plane.z >= 0.f ? max.z : min.z);
+			return ((plane.x * corner.x + plane.y * corner.y) + plane.z * corner.z) + plane.w < 0.f;
+		}
+
+		bool inside(const glm::vec4& plane, const glm::vec3& min, const glm::vec3& max)
+		{
+			const glm::vec3 corner(plane.x >= 0.f ? min.x : max.x, plane.y >= 0.f ? min.y : max.y, plane.z >= 0.f ? min.z : max.z);
+			return ((plane.x * corner.x + plane.y * corner.y) + plane.z * corner.z) + plane.w >= 0.f;
+		}
+
+		bool overlaps(const Bvh::Aabb& box, const glm::vec3& min, const glm::vec3& max)
+		{
+			return box.min.x <= max.x && box.max.x >= min.x && box.min.y <= max.y && box.max.y >= min.y
+				&& box.min.z <= max.z && box.max.z >= min.z;
+		}
+
+		// distance at which the ray enters the box, or infinity
+		float intersect(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance,
+			const glm::vec3& min, const glm::vec3& max)
+		{
+			const glm::vec3 t0 = (min - origin) * inverseDirection;
+			const glm::vec3 t1 = (max - origin) * inverseDirection;
+			const glm::vec3 near = glm::min(t0, t1);
+			const glm::vec3 far = glm::max(t0, t1);
+			const float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.f));
+			const float exit = std::min(std::min(far.x, far.y), std::min(far.z, maxDistance));
+			return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+		}
+
+		// reduces function(begin, end) over [begin, end) on the job system for large ranges
+		template<typename Result, typename Function, typename Combine>
+		Result reduce(util::JobSystem* jobSystem, size_t begin, size_t end, const Function& function, const Combine& combine)
+		{
+			const size_t grain = Bvh::PARALLEL_THRESHOLD;
+			if (!jobSystem || end - begin < 4 * grain)
+				return function(begin, end);
+
+			std::vector<Result> partials((end - begin + grain - 1) / grain);
+			jobSystem->parallelFor(end - begin, grain, [&](size_t first, size_t last) {
+				partials[first / grain] = function(begin + first, begin + last);
+			});
+
+			Result result = partials.front();
+			for (size_t i = 1; i < partials.size(); ++i)
+				combine(result, partials[i]);
+			return result;
+		}
+
+		struct RangeBounds {
+			Bvh::Aabb bounds;
+			Bvh::Aabb centroids;
+		};
+
+		struct Bins {
+			Bvh::Aabb bounds[3][Bvh::BIN_COUNT];
+			uint32_t counts[3][Bvh::BIN_COUNT];
+		};
+	}
+
+	void Bvh::build(const Aabb* bounds, size_t count, util::JobSystem* jobSystem)
+	{
+		clear();
+		if (!count)
+			return;
+
+		_bounds.assign(bounds, bounds + count);
+		_indices.resize(count);
+		for (uint32_t i = 0; i < count; ++i)
+			_indices[i] = i;
+		_leaves.resize(count);
+
+		// a binary tree with at least one primitive per leaf has at most 2n - 1 nodes
+		_nodes.resize(2 * count - 1);
+		_parents.resize(2 * count - 1);
+		_parents[0] = 0;
+		_nodeCount = 1;
+		split(0, 0, static_cast<uint32_t>(count), jobSystem);
+		_nodes.resize(_nodeCount);
+		_parents.resize(_nodeCount);
+
+		_weightedArea = 0.;
+		for (const auto& node : _nodes)
+			_weightedArea += area(node.min, node.max) * (node.count ? node.count : TRAVERSAL_COST);
+		_buildCost = cost();
+	}
+
+	void Bvh::clear()
+	{
+		_bounds.clear();
+		_indices.clear();
+		_nodes.clear();
+		_parents.clear();
+		_leaves.clear();
+		_moved.clear();
+		_nodeCount = 0;
+		_weightedArea = 0.;
+		_buildCost = 0.f;
+	}
+
+	void Bvh::split(uint32_t nodeIndex, uint32_t begin, uint32_t end, util::JobSystem* jobSystem)
+	{
+		// children come from an atomic counter, the vector never grows during the build
+		Node& node = _nodes[nodeIndex];
+
+		const RangeBounds range = reduce<RangeBounds>(jobSystem, begin, end, [this](size_t first, size_t last) {
+			RangeBounds result = { emptyBox(), emptyBox() };
+			for (size_t i = first; i < last; ++i) {
+				const Aabb& box = _bounds[_indices[i]];
+				grow(result.bounds, box);
+				grow(result.centroids, centroid(box));
+			}
+			return result;
+		}, [](RangeBounds& result, const RangeBounds& other) {
+			grow(result.bounds, other.bounds);
+			grow(result.centroids, other.centroids);
+		});
+
+		node.min = range.bounds.min;
+		node.max = range.bounds.max;
+
+		const uint32_t count = end - begin;
+		const glm::vec3 extent = range.centroids.max - range.centroids.min;
+		if (count <= MAX_LEAF_SIZE || std::max(std::max(extent.x, extent.y), extent.z) <= 0.f) {
+			// identical centroids cannot be binned apart, they end up in one leaf whatever their number
+			node.first = begin;
+			node.count = count;
+			for (uint32_t i = begin; i < end; ++i)
+				_leaves[_indices[i]] = nodeIndex;
+			return;
+		}
+
+		// bin the centroids along all three axes
+		const glm::vec3 scale = glm::vec3(static_cast<float>(BIN_COUNT)) / glm::max(extent, glm::vec3(std::numeric_limits<float>::min()));
+		const auto binOf = [&range, &scale](const glm::vec3& point, int axis) {
+			const int bin = static_cast<int>((point[axis] - range.centroids.min[axis]) * scale[axis]);
+			return std::min(std::max(bin, 0), static_cast<int>(BIN_COUNT) - 1);
+		};
+
+		const Bins bins = reduce<Bins>(jobSystem, begin, end, [this, &binOf](size_t first, size_t last) {
+			Bins result;
+			for (int axis = 0; axis < 3; ++axis)
+				for (uint32_t bin = 0; bin < BIN_COUNT; ++bin) {
+					result.bounds[axis][bin] = emptyBox();
+					result.counts[axis][bin] = 0;
+				}
+
+			for (size_t i = first; i < last; ++i) {
+				const Aabb& box = _bounds[_indices[i]];
+				const glm::vec3 point = centroid(box);
+				for (int axis = 0; axis < 3; ++axis) {
+					const int bin = binOf(point, axis);
+					grow(result.bounds[axis][bin], box);
+					++result.counts[axis][bin];
+				}
+			}
+			return result;
+		}, [](Bins& result, const Bins& other) {
+			for (int axis = 0; axis < 3; ++axis)
+				for (uint32_t bin = 0; bin < BIN_COUNT; ++bin) {
+					grow(result.bounds[axis][bin], other.bounds[axis][bin]);
+					result.counts[axis][bin] += other.counts[axis][bin];
+				}
+		});
+
+		// sweep the split planes between bins, left to right then right to left
+		float bestCost = std::numeric_limits<float>::max();
+		int bestAxis = -1;
+		uint32_t bestSplit = 0;
+		for (int axis = 0; axis < 3; ++axis) {
+			float leftCost[BIN_COUNT];
+			Aabb box = emptyBox();
+			uint32_t leftCount = 0;
+			for (uint32_t bin = 0; bin + 1 < BIN_COUNT; ++bin) {
+				grow(box, bins.bounds[axis][bin]);
+				leftCount += bins.counts[axis][bin];
+				leftCost[bin] = leftCount ? area(box) * leftCount : 0.f;
+			}
+
+			box = emptyBox();
+			uint32_t rightCount = 0;
+			for (uint32_t bin = BIN_COUNT - 1; bin > 0; --bin) {
+				grow(box, bins.bounds[axis][bin]);
+				rightCount += bins.counts[axis][bin];
+				const float splitCost = leftCost[bin - 1] + (rightCount ? area(box) * rightCount : 0.f);
+				if (rightCount && rightCount < count && splitCost < bestCost) {
+					bestCost = splitCost;
+					bestAxis = axis;
+					bestSplit = bin;
+				}
+			}
+		}
+
+		uint32_t middle = begin + count / 2;
+		if (bestAxis >= 0)
+			middle = static_cast<uint32_t>(std::partition(_indices.begin() + begin, _indices.begin() + end, [&](uint32_t index) {
+				return binOf(centroid(_bounds[index]), bestAxis) < static_cast<int>(bestSplit);
+			}) - _indices.begin());
+
+		const uint32_t children = _nodeCount.fetch_add(2, std::memory_order_relaxed);
+		node.first = children;
+		node.count = 0;
+		_parents[children] = nodeIndex;
+		_parents[children + 1] = nodeIndex;
+
+		if (jobSystem && count > PARALLEL_THRESHOLD) {
+			util::JobSystem::Counter left;
+			jobSystem->run([this, children, begin, middle, jobSystem] { split(children, begin, middle, jobSystem); }, &left);
+			split(children + 1, middle, end, jobSystem);
+			jobSystem->wait(left);
+		}
+		else {
+			split(children, begin, middle, jobSystem);
+			split(children + 1, middle, end, jobSystem);
+		}
+	}
+
+	void Bvh::update(uint32_t index, const Aabb& bounds)
+	{
+		_bounds[index] = bounds;
+		_moved.push_back(index);
+	}
+
+	bool Bvh::refitNode(uint32_t nodeIndex)
+	{
+		Node& node = _nodes[nodeIndex];
+		Aabb box = emptyBox();
+		if (node.count)
+			for (uint32_t i = node.first; i < node.first + node.count; ++i)
+				grow(box, _bounds[_indices[i]]);
+		else {
+			grow(box, { _nodes[node.first].min, _nodes[node.first].max });
+			grow(box, { _nodes[node.first + 1].min, _nodes[node.first + 1].max });
+		}
+
+		if (box.min == node.min && box.max == node.max)
+			return false;
+
+		const float weight = node.count ? node.count : TRAVERSAL_COST;
+		_weightedArea += (static_cast<double>(area(box)) - area(node.min, node.max)) * weight;
+		node.min = box.min;
+		node.max = box.max;
+		return true;
+	}
+
+	bool Bvh::refit(util::JobSystem* jobSystem)
+	{
+		if (_moved.empty())
+			return false;
+
+		// walking up from every moved primitive costs its depth, past some share a full pass is cheaper
+		if (_moved.size() * 8 > _nodes.size()) {
+			// children always come after their parent
+			for (size_t node = _nodes.size(); node-- > 0;)
+				refitNode(static_cast<uint32_t>(node));
+		}
+		else
+			for (uint32_t index : _moved)
+				for (uint32_t node = _leaves[index]; refitNode(node) && node != 0;)
+					node = _parents[node];
+		_moved.clear();
+
+		if (cost() <= _buildCost * REBUILD_THRESHOLD)
+			return false;
+
+		const std::vector<Aabb> bounds = std::move(_bounds);
+		build(bounds.data(), bounds.size(), jobSystem);
+		return true;
+	}
+
+	float Bvh::cost() const
+	{
+		if (_nodes.empty())
+			return 0.f;
+		return static_cast<float>(_weightedArea / std::max(area(_nodes[0].min, _nodes[0].max), std::numeric_limits<float>::min()));
+	}
+
+	size_t Bvh::cull(const glm::vec4 planes[6], std::vector<uint32_t>& visible) const
+	{
+		visible.clear();
+		if (_nodes.empty())
+			return 0;
+
+		// planes a node is entirely in front of are not tested again below it
+		struct Entry {
+			uint32_t node;
+			uint32_t planeMask;
+		};
+		std::vector<Entry> stack;
+		stack.reserve(64);
+		stack.push_back({ 0, 0x3f });
+
+		while (!stack.empty()) {
+			const Entry entry = stack.back();
+			stack.pop_back();
+			const Node& node = _nodes[entry.node];
+
+			uint32_t planeMask = entry.planeMask;
+			bool culled = false;
+			for (int p = 0; p < 6 && !culled; ++p)
+				if (planeMask & (1u << p)) {
+					culled = outside(planes[p], node.min, node.max);
+					if (inside(planes[p], node.min, node.max))
+						planeMask &= ~(1u << p);
+				}
+			if (culled)
+				continue;
+
+			if (!node.count) {
+				stack.push_back({ node.first + 1, planeMask });
+				stack.push_back({ node.first, planeMask });
+				continue;
+			}
+
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				const uint32_t index = _indices[i];
+				bool primitiveCulled = false;
+				for (int p = 0; p < 6 && !primitiveCulled; ++p)
+					primitiveCulled = (planeMask & (1u << p)) && outside(planes[p], _bounds[index].min, _bounds[index].max);
+				if (!primitiveCulled)
+					visible.push_back(index);
+			}
+		}
+
+		return visible.size();
+	}
+
+	bool Bvh::culled(const glm::vec4 planes[6], const Aabb& box)
+	{
+		for (int p = 0; p < 6; ++p)
+			if (outside(planes[p], box.min, box.max))
+				return true;
+		return false;
+	}
+
+	bool Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit) const
+	{
+		if (_nodes.empty())
+			return false;
+
+		// intersect() returns infinity for a miss, which an infinite maxDistance would not reject
+		const float miss = std::numeric_limits<float>::infinity();
+		const glm::vec3 inverseDirection = 1.f / direction;
+		hit = { 0, miss };
+		bool found = false;
+
+		// nodes keep the distance the ray enters them, they are skipped once a nearer hit is known
+		struct Entry {
+			uint32_t node;
+			float distance;
+		};
+		std::vector<Entry> stack;
+		stack.reserve(64);
+		const float rootDistance = intersect(origin, inverseDirection, maxDistance, _nodes[0].min, _nodes[0].max);
+		if (rootDistance != miss)
+			stack.push_back({ 0, rootDistance });
+
+		while (!stack.empty()) {
+			const Entry entry = stack.back();
+			stack.pop_back();
+			const float limit = std::min(maxDistance, hit.distance);
+			if (entry.distance > limit)
+				continue;
+
+			const Node& node = _nodes[entry.node];
+			if (node.count) {
+				for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+					const uint32_t index = _indices[i];
+					const float distance = intersect(origin, inverseDirection, std::min(maxDistance, hit.distance),
+						_bounds[index].min, _bounds[index].max);
+					if (distance == miss)
+						continue;
+					if (!found || distance < hit.distance || (distance == hit.distance && index < hit.index))
+						hit = { index, distance };
+					found = true;
+				}
+				continue;
+			}
+
+			// the nearer child goes on top of the stack, so the further one often gets skipped
+			Entry left = { node.first, intersect(origin, inverseDirection, limit, _nodes[node.first].min, _nodes[node.first].max) };
+			Entry right = { node.first + 1, intersect(origin, inverseDirection, limit, _nodes[node.first + 1].min, _nodes[node.first + 1].max) };
+			if (right.distance < left.distance)
+				std::swap(left, right);
+			if (right.distance != miss)
+				stack.push_back(right);
+			if (left.distance != miss)
+				stack.push_back(left);
+		}
+
+		return found;
+	}
+
+	size_t Bvh::query(const Aabb& box, std::vector<uint32_t>& results) const
+	{
+		results.clear();
+		if (_nodes.empty())
+			return 0;
+
+		std::vector<uint32_t> stack;
+		stack.reserve(64);
+		stack.push_back(0);
+
+		while (!stack.empty()) {
+			const Node& node = _nodes[stack.back()];
+			stack.pop_back();
+			if (!overlaps(box, node.min, node.max))
+				continue;
+
+			if (!node.count) {
+				stack.push_back(node.first + 1);
+				stack.push_back(node.first);
+				continue;
+			}
+
+			for (uint32_t i = node.first; i < node.first + node.count; ++i)
+				if (overlaps(box, _bounds[_indices[i]].min, _bounds[_indices[i]].max))
+					results.push_back(_indices[i]);
+		}
+
+		return results.size();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "NonCopyable.h"
+#include "JobSystem.h"
+
+namespace core
+{
+	// Bounding volume hierarchy over axis aligned boxes, built top-down with a binned surface area
+	// heuristic. Nodes are 32 bytes in one flat array; the two children of a node are allocated as a
+	// pair after their parent, so a sibling test touches one cache line and every child comes after
+	// its parent. Moving primitives are handled by refitting the nodes above them, a rebuild happens
+	// once refitting has degraded the tree's SAH cost by more than REBUILD_THRESHOLD.
+	class Bvh : public util::NonCopyable
+	{
+	public:
+		static constexpr uint32_t MAX_LEAF_SIZE = 4;
+		static constexpr uint32_t BIN_COUNT = 16;
+		// ranges smaller than this are built, binned and bounded on one thread
+		static constexpr size_t PARALLEL_THRESHOLD = 4096;
+		static constexpr float REBUILD_THRESHOLD = 1.5f;
+
+		struct Aabb {
+			glm::vec3 min;
+			glm::vec3 max;
+		};
+
+		// leaves have a count and hold primitives [first, first + count) of the index list, inner
+		// nodes have a count of 0 and their children at first and first + 1
+		struct Node {
+			glm::vec3 min;
+			uint32_t first;
+			glm::vec3 max;
+			uint32_t count;
+		};
+		static_assert(sizeof(Node) == 32, "Node is meant to fill half a cache line");
+
+		struct Hit {
+			uint32_t index;
+			float distance;
+		};
+
+		Bvh() = default;
+		~Bvh() = default;
+
+		// builds over count boxes, primitive i being bounds[i]; the top levels split in parallel
+		// when a job system is given
+		void build(const Aabb* bounds, size_t count, util::JobSystem* jobSystem = nullptr);
+		void clear();
+
+		// moves a primitive, the tree follows on the next refit
+		void update(uint32_t index, const Aabb& bounds);
+		// refits the nodes above the primitives updated since the last call, a full bottom-up pass when
+		// many moved. Returns true when the refitted tree was too degraded and got rebuilt instead
+		bool refit(util::JobSystem* jobSystem = nullptr);
+
+		// indices of the primitives whose box is not outside one of the planes (normalized, pointing inside)
+		size_t cull(const glm::vec4 planes[6], std::vector<uint32_t>& visible) const;
+		// the test cull applies to every primitive it reaches, for brute force comparisons
+		static bool culled(const glm::vec4 planes[6], const Aabb& box);
+		// nearest primitive box the ray enters within maxDistance, direction needs not be normalized
+		// and distances are in its units
+		bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit) const;
+		// indices of the primitives whose box overlaps box
+		size_t query(const Aabb& box, std::vector<uint32_t>& results) const;
+
+		// expected node visits plus primitive tests of a random ray hitting the root, lower is better
+		float cost() const;
+
+		size_t size() const { return _bounds.size(); }
+		const std::vector<Node>& nodes() const { return _nodes; }
+
+	private:
+		std::vector<Aabb> _bounds;
+		std::vector<uint32_t> _indices;
+		std::vector<Node> _nodes;
+		std::vector<uint32_t> _parents;		// per node, the root is its own parent
+		std::vector<uint32_t> _leaves;		// per primitive, the leaf holding it
+		std::vector<uint32_t> _moved;
+		std::atomic<uint32_t> _nodeCount { 0 };
+
+		// sum of node areas weighted by their cost, kept up to date by refit; the SAH cost once
+		// divided by the root area
+		double _weightedArea = 0.;
+		float _buildCost = 0.f;
+
+		void split(uint32_t node, uint32_t begin, uint32_t end, util::JobSystem* jobSystem);
+		// recomputes the bounds of one node from its children or primitives, returns true if they changed
+		bool refitNode(uint32_t node);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "ClusterCuller.h"
+
+#include <algorithm>
+#include <string>
+
+#ifndef _DEBUG
+	#define LOGGING_DISABLE
+#endif
+
+#include "Logging.h"
+
+namespace core
+{
+	void ClusterCuller::init(VkDevice device, MemoryAllocator& allocator, UploadManager& uploads, VkPipelineCache pipelineCache,
+		const std::vector<char>& shaderCode, uint32_t slotCount, const Meshlet* meshlets, uint32_t meshletCount,
+		bool multiDrawIndirect)
+	{
+		_device = device;
+		_allocator = &allocator;
+		_meshletCount = meshletCount;
+		_multiDrawIndirect = multiDrawIndirect;
+		_stats = Stats();
+
+		_triangleCount = 0;
+		for (uint32_t i = 0; i < meshletCount; ++i)
+			_triangleCount += meshlets[i].indexCount / 3;
+
+		_pass.init(_device, pipelineCache, shaderCode, 3, sizeof(PushConstants), slotCount);
+
+		const VkDeviceSize meshletsSize = static_cast<VkDeviceSize>(meshletCount) * sizeof(Meshlet);
+		_meshlets = ComputePass::createBuffer(_device, meshletsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		_meshletsMemory = _allocator->bind(_meshlets, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (!uploads.upload(_meshlets, 0, meshlets, meshletsSize))
+			THROW("meshlets of " + std::to_string(meshletsSize) + " bytes do not fit in the upload ring")
+
+		_slots.resize(slotCount);
+		for (uint32_t i = 0; i < slotCount; ++i) {
+			Slot& slot = _slots[i];
+			slot.commands = ComputePass::createBuffer(_device, static_cast<VkDeviceSize>(meshletCount) * sizeof(VkDrawIndexedIndirectCommand),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+			slot.commandsMemory = _allocator->bind(slot.commands, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+			// two counters, read by the CPU once the slot's fence signaled
+			slot.statistics = ComputePass::createBuffer(_device, 2 * sizeof(uint32_t),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+			slot.statisticsMemory = _allocator->bind(slot.statistics, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+			slot.pending = false;
+
+			_pass.setBuffers(i, { _meshlets, slot.commands, slot.statistics });
+		}
+	}
+
+	void ClusterCuller::clean()
+	{
+		if (_device == VK_NULL_HANDLE)
+			return;
+
+		for (auto& slot : _slots) {
+			vkDestroyBuffer(_device, slot.commands, nullptr);
+			_allocator->free(slot.commandsMemory);
+			vkDestroyBuffer(_device, slot.statistics, nullptr);
+			_allocator->free(slot.statisticsMemory);
+		}
+		_slots.clear();
+
+		vkDestroyBuffer(_device, _meshlets, nullptr);
+		_allocator->free(_meshletsMemory);
+
+		_pass.clean();
+		_device = VK_NULL_HANDLE;
+	}
+
+	void ClusterCuller::cull(VkCommandBuffer commandBuffer, uint32_t slot, const glm::vec4 (&planes)[6], const glm::vec4& camera)
+	{
+		Slot& current = _slots[slot];
+		if (current.pending)
+			collect(current, _stats);
+
+		vkCmdFillBuffer(commandBuffer, current.statistics, 0, VK_WHOLE_SIZE, 0);
+
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			1, &barrier, 0, nullptr, 0, nullptr);
+
+		PushConstants pushConstants;
+		std::copy(std::begin(planes), std::end(planes), pushConstants.planes);
+		pushConstants.camera = camera;
+		pushConstants.meshletCount = _meshletCount;
+
+		_pass.dispatch(commandBuffer, slot, &pushConstants, _meshletCount);
+
+		// the commands are read by the draws of this frame, the counters by the CPU after the fence
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+			1, &barrier, 0, nullptr, 0, nullptr);
+
+		current.pending = true;
+	}
+
+	void ClusterCuller::draw(VkCommandBuffer commandBuffer, uint32_t slot) const
+	{
+		const VkBuffer commands = _slots[slot].commands;
+		const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+		// without multiDrawIndirect a call may only read one command
+		if (_multiDrawIndirect)
+			vkCmdDrawIndexedIndirect(commandBuffer, commands, 0, _meshletCount, stride);
+		else
+			for (uint32_t i = 0; i < _meshletCount; ++i)
+				vkCmdDrawIndexedIndirect(commandBuffer, commands, static_cast<VkDeviceSize>(i) * stride, 1, stride);
+	}
+
+	ClusterCuller::Stats ClusterCuller::stats() const
+	{
+		Stats stats = _stats;
+		for (const auto& slot : _slots)
+			if (slot.pending)
+				collect(slot, stats);
+
+		return stats;
+	}
+
+	void ClusterCuller::collect(const Slot& slot, Stats& stats) const
+	{
+		const uint32_t* counters = static_cast<const uint32_t*>(slot.statisticsMemory.mapped);
+
+		++stats.frames;
+		stats.meshlets += _meshletCount;
+		stats.triangles += _triangleCount;
+		stats.visibleMeshlets += counters[0];
+		stats.visibleTriangles += counters[1];
+	}
+}
\ No newline at end of file
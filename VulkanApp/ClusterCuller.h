@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "NonCopyable.h"
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+#include "Meshlet.h"
+#include "ComputePass.h"
+
+namespace core
+{
+	// Culls the meshlets of one mesh on the GPU against the frustum and their normal cones.
+	// ClusterCulling.comp writes one indexed indirect command per meshlet, culled meshlets get no
+	// instance, and counts what survived. Every slot (frame in flight) has its own commands and
+	// counters; the counters are read when the slot is culled again, after its fence signaled.
+	class ClusterCuller : public util::NonCopyable
+	{
+	public:
+		struct Stats {
+			uint64_t frames = 0;
+			uint64_t meshlets = 0;
+			uint64_t triangles = 0;
+			uint64_t visibleMeshlets = 0;
+			uint64_t visibleTriangles = 0;
+		};
+
+		ClusterCuller() = default;
+		~ClusterCuller() = default;
+
+		// meshlets are queued on the upload ring, their index ranges refer to the mesh bound when drawing
+		void init(VkDevice device, MemoryAllocator& allocator, UploadManager& uploads, VkPipelineCache pipelineCache,
+			const std::vector<char>& shaderCode, uint32_t slotCount, const Meshlet* meshlets, uint32_t meshletCount,
+			bool multiDrawIndirect);
+		void clean();
+
+		// Outside of a render pass. Planes are in mesh space, inside where dot(xyz, p) + w >= 0. Camera
+		// is a position (w = 1) or the view direction of an orthographic camera (w = 0), in the winding
+		// convention the meshlet cones were built with.
+		void cull(VkCommandBuffer commandBuffer, uint32_t slot, const glm::vec4 (&planes)[6], const glm::vec4& camera);
+		// inside the render pass, with the mesh bound
+		void draw(VkCommandBuffer commandBuffer, uint32_t slot) const;
+
+		// includes the slots still pending, only complete once the device is idle
+		Stats stats() const;
+
+	private:
+		struct PushConstants {
+			glm::vec4 planes[6];
+			glm::vec4 camera;
+			uint32_t meshletCount;
+		};
+
+		struct Slot {
+			VkBuffer commands;
+			MemoryAllocator::Allocation commandsMemory;
+			VkBuffer statistics;
+			MemoryAllocator::Allocation statisticsMemory;
+			bool pending;
+		};
+
+		VkDevice _device = VK_NULL_HANDLE;
+		MemoryAllocator* _allocator = nullptr;
+		ComputePass _pass;
+
+		VkBuffer _meshlets;
+		MemoryAllocator::Allocation _meshletsMemory;
+		uint32_t _meshletCount;
+		uint64_t _triangleCount;
+		bool _multiDrawIndirect;
+
+		std::vector<Slot> _slots;
+		Stats _stats;
+
+		void collect(const Slot& slot, Stats& stats) const;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "CommandRecorder.h"
+
+#include <string>
+#include <algorithm>
+#include <exception>
+#include <mutex>
+
+#ifndef _DEBUG
+	#define LOGGING_DISABLE
+#endif
+
+#include "Logging.h"
+#include "Profiler.h"
+
+namespace core
+{
+	void CommandRecorder::init(VkDevice device, uint32_t queueFamily, util::JobSystem& jobSystem, uint32_t slotCount)
+	{
+		_device = device;
+		_jobSystem = &jobSystem;
+
+		_pools.resize(_jobSystem->threadCount());
+		for (auto& threadPools : _pools) {
+			threadPools.resize(slotCount);
+			for (auto& pool : threadPools) {
+				VkCommandPoolCreateInfo poolInfo = {};
+				poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+				poolInfo.queueFamilyIndex = queueFamily;
+				poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+				VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &pool.commandPool);
+				if (result != VK_SUCCESS)
+					THROW("failed to create worker command pool with error: " + std::to_string(result))
+
+				pool.used = 0;
+			}
+		}
+	}
+
+	void CommandRecorder::record(VkCommandBuffer primary, uint32_t slot, const VkRenderPassBeginInfo& renderPassInfo,
+		size_t drawCount, const RecordFunction& function)
+	{
+		const size_t rangeCount = std::min<size_t>(threadCount(), drawCount);
+		const size_t chunk = rangeCount ? (drawCount + rangeCount - 1) / rangeCount : 0;
+
+		std::vector<VkCommandBuffer> secondaries(rangeCount, VK_NULL_HANDLE);
+		std::exception_ptr error;
+		std::mutex errorMutex;
+
+		_jobSystem->parallelFor(rangeCount, 1, [&](size_t begin, size_t end) {
+			// the pools of a thread are only ever touched by that thread
+			std::vector<Pool>& threadPools = _pools[_jobSystem->threadIndex()];
+
+			for (size_t range = begin; range < end; ++range) {
+				const size_t first = range * chunk;
+				if (first >= drawCount)
+					continue;
+
+				try {
+					PROFILE_ZONE("record secondary")
+
+					VkCommandBuffer commandBuffer = acquire(threadPools[slot]);
+
+					VkCommandBufferInheritanceInfo inheritanceInfo = {};
+					inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+					inheritanceInfo.renderPass = renderPassInfo.renderPass;
+					inheritanceInfo.subpass = 0;
+					inheritanceInfo.framebuffer = renderPassInfo.framebuffer;
+
+					VkCommandBufferBeginInfo beginInfo = {};
+					beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+					beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+					beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+					vkBeginCommandBuffer(commandBuffer, &beginInfo);
+					function(commandBuffer, first, std::min(chunk, drawCount - first));
+
+					VkResult result = vkEndCommandBuffer(commandBuffer);
+					if (result != VK_SUCCESS)
+						THROW("failed to record secondary command buffer with error: " + std::to_string(result))
+
+					secondaries[range] = commandBuffer;
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock(errorMutex);
+					error = std::current_exception();
+				}
+			}
+		});
+
+		if (error)
+			std::rethrow_exception(error);
+
+		secondaries.erase(std::remove(secondaries.begin(), secondaries.end(), static_cast<VkCommandBuffer>(VK_NULL_HANDLE)), secondaries.end());
+
+		vkCmdBeginRenderPass(primary, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		if (!secondaries.empty())
+			vkCmdExecuteCommands(primary, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+		vkCmdEndRenderPass(primary);
+	}
+
+	VkCommandBuffer CommandRecorder::acquire(Pool& pool)
+	{
+		if (pool.used == pool.commandBuffers.size()) {
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = pool.commandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = 1;
+
+			VkCommandBuffer commandBuffer;
+			VkResult result = vkAllocateCommandBuffers(_device, &allocInfo, &commandBuffer);
+			if (result != VK_SUCCESS)
+				THROW("failed to allocate secondary command buffer with error: " + std::to_string(result))
+
+			pool.commandBuffers.push_back(commandBuffer);
+		}
+
+		return pool.commandBuffers[pool.used++];
+	}
+
+	void CommandRecorder::reset(uint32_t slot)
+	{
+		// only called between record() calls, no thread is recording into the pools
+		for (auto& threadPools : _pools) {
+			Pool& pool = threadPools[slot];
+			vkResetCommandPool(_device, pool.commandPool, 0);
+			pool.used = 0;
+		}
+	}
+
+	void CommandRecorder::clean()
+	{
+		for (auto& threadPools : _pools)
+			for (auto& pool : threadPools)
+				vkDestroyCommandPool(_device, pool.commandPool, nullptr);
+
+		_pools.clear();
+	}
+}
\ No newline at end of file
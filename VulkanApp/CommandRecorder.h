@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <functional>
+
+#include "NonCopyable.h"
+#include "JobSystem.h"
+
+namespace core
+{
+	// Records the draws of a render pass on the job system threads. Every thread owns a
+	// transient command pool per slot (frame in flight) and records a contiguous range of the
+	// draw list into a secondary buffer of that pool, the primary buffer then runs them with
+	// vkCmdExecuteCommands. Buffers are never freed one by one: once the slot's frame has
+	// completed, reset() recycles all of them at once with vkResetCommandPool.
+	class CommandRecorder : public util::NonCopyable
+	{
+	public:
+		typedef std::function<void(VkCommandBuffer commandBuffer, size_t first, size_t count)> RecordFunction;
+
+		CommandRecorder() = default;
+		~CommandRecorder() = default;
+
+		void init(VkDevice device, uint32_t queueFamily, util::JobSystem& jobSystem, uint32_t slotCount);
+		void record(VkCommandBuffer primary, uint32_t slot, const VkRenderPassBeginInfo& renderPassInfo,
+			size_t drawCount, const RecordFunction& function);
+		void reset(uint32_t slot);
+		void clean();
+
+		uint32_t threadCount() const { return static_cast<uint32_t>(_pools.size()); }
+
+	private:
+		struct Pool {
+			VkCommandPool commandPool;
+			std::vector<VkCommandBuffer> commandBuffers;
+			size_t used;
+		};
+
+		VkDevice _device = VK_NULL_HANDLE;
+		util::JobSystem* _jobSystem = nullptr;
+
+		// indexed by job system thread, then by slot
+		std::vector<std::vector<Pool>> _pools;
+
+		VkCommandBuffer acquire(Pool& pool);
+	};
+}
\ No newline at end of file
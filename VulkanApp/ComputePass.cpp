@@ -0,0 +1,158 @@
+#include "ComputePass.h"
+
+#include <string>
+
+#ifndef _DEBUG
+	#define LOGGING_DISABLE
+#endif
+
+#include "Logging.h"
+
+namespace core
+{
+	void ComputePass::init(VkDevice device, VkPipelineCache pipelineCache, const std::vector<char>& shaderCode,
+		uint32_t bufferCount, uint32_t pushConstantSize, uint32_t slotCount)
+	{
+		_device = device;
+		_pushConstantSize = pushConstantSize;
+
+		std::vector<VkDescriptorSetLayoutBinding> bindings(bufferCount);
+		for (uint32_t i = 0; i < bufferCount; ++i) {
+			bindings[i] = {};
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = bufferCount;
+		layoutInfo.pBindings = bindings.data();
+
+		VkResult result = vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_descriptorSetLayout);
+		if (result != VK_SUCCESS)
+			THROW("failed to create compute descriptor set layout with error: " + std::to_string(result))
+
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.size = pushConstantSize;
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &_descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize ? 1 : 0;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		result = vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_pipelineLayout);
+		if (result != VK_SUCCESS)
+			THROW("failed to create compute pipeline layout with error: " + std::to_string(result))
+
+		VkShaderModuleCreateInfo moduleInfo = {};
+		moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleInfo.codeSize = shaderCode.size();
+		moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+		VkShaderModule shaderModule;
+		result = vkCreateShaderModule(_device, &moduleInfo, nullptr, &shaderModule);
+		if (result != VK_SUCCESS)
+			THROW("failed to create compute shader module with error: " + std::to_string(result))
+
+		VkComputePipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = shaderModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = _pipelineLayout;
+
+		result = vkCreateComputePipelines(_device, pipelineCache, 1, &pipelineInfo, nullptr, &_pipeline);
+		vkDestroyShaderModule(_device, shaderModule, nullptr);
+		if (result != VK_SUCCESS)
+			THROW("failed to create compute pipeline with error: " + std::to_string(result))
+
+		VkDescriptorPoolSize poolSize = {};
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSize.descriptorCount = slotCount * bufferCount;
+
+		VkDescriptorPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = slotCount;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+
+		result = vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_descriptorPool);
+		if (result != VK_SUCCESS)
+			THROW("failed to create compute descriptor pool with error: " + std::to_string(result))
+
+		const std::vector<VkDescriptorSetLayout> layouts(slotCount, _descriptorSetLayout);
+		VkDescriptorSetAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.descriptorPool = _descriptorPool;
+		allocateInfo.descriptorSetCount = slotCount;
+		allocateInfo.pSetLayouts = layouts.data();
+
+		_descriptorSets.resize(slotCount);
+		result = vkAllocateDescriptorSets(_device, &allocateInfo, _descriptorSets.data());
+		if (result != VK_SUCCESS)
+			THROW("failed to allocate compute descriptor sets with error: " + std::to_string(result))
+	}
+
+	void ComputePass::clean()
+	{
+		if (_device == VK_NULL_HANDLE)
+			return;
+
+		vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
+		vkDestroyPipeline(_device, _pipeline, nullptr);
+		vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(_device, _descriptorSetLayout, nullptr);
+		_descriptorSets.clear();
+		_device = VK_NULL_HANDLE;
+	}
+
+	VkBuffer ComputePass::createBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage)
+	{
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkBuffer buffer;
+		VkResult result = vkCreateBuffer(device, &bufferInfo, nullptr, &buffer);
+		if (result != VK_SUCCESS)
+			THROW("failed to create compute pass buffer with error: " + std::to_string(result))
+
+		return buffer;
+	}
+
+	void ComputePass::setBuffers(uint32_t slot, const std::vector<VkBuffer>& buffers)
+	{
+		std::vector<VkDescriptorBufferInfo> bufferInfos(buffers.size());
+		std::vector<VkWriteDescriptorSet> writes(buffers.size());
+		for (uint32_t i = 0; i < buffers.size(); ++i) {
+			bufferInfos[i] = { buffers[i], 0, VK_WHOLE_SIZE };
+
+			writes[i] = {};
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = _descriptorSets[slot];
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+
+	void ComputePass::dispatch(VkCommandBuffer commandBuffer, uint32_t slot, const void* pushConstants, uint32_t invocationCount) const
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &_descriptorSets[slot], 0, nullptr);
+		if (_pushConstantSize)
+			vkCmdPushConstants(commandBuffer, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, _pushConstantSize, pushConstants);
+		vkCmdDispatch(commandBuffer, (invocationCount + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+	}
+}
\ No newline at end of file
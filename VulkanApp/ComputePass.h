@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+#include "NonCopyable.h"
+
+namespace core
+{
+	// A compute pipeline that only reads storage buffers (set 0, binding i for buffer i) and push
+	// constants, with one descriptor set per slot (frame in flight). Shaders run GROUP_SIZE wide
+	// in x and skip the invocations past the count they are given.
+	class ComputePass : public util::NonCopyable
+	{
+	public:
+		static constexpr uint32_t GROUP_SIZE = 64;
+
+		ComputePass() = default;
+		~ComputePass() = default;
+
+		void init(VkDevice device, VkPipelineCache pipelineCache, const std::vector<char>& shaderCode,
+			uint32_t bufferCount, uint32_t pushConstantSize, uint32_t slotCount);
+		void clean();
+
+		// an exclusive buffer for the passes to read and write, its memory is bound by the caller
+		static VkBuffer createBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage);
+
+		void setBuffers(uint32_t slot, const std::vector<VkBuffer>& buffers);
+		void dispatch(VkCommandBuffer commandBuffer, uint32_t slot, const void* pushConstants, uint32_t invocationCount) const;
+
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+		VkDescriptorSetLayout _descriptorSetLayout;
+		VkDescriptorPool _descriptorPool;
+		VkPipelineLayout _pipelineLayout;
+		VkPipeline _pipeline;
+		uint32_t _pushConstantSize;
+		std::vector<VkDescriptorSet> _descriptorSets;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "FrameReadback.h"
+
+#include <limits>
+#include <string>
+
+#ifndef _DEBUG
+	#define LOGGING_DISABLE
+#endif
+
+#include "Logging.h"
+
+namespace core
+{
+	void FrameReadback::init(VkDevice device, MemoryAllocator& allocator, uint32_t queueFamily,
+		VkExtent2D extent, uint32_t slotCount, const Callback& callback)
+	{
+		_device = device;
+		_allocator = &allocator;
+		_extent = extent;
+		_size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+		_callback = callback;
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = queueFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &_commandPool);
+		if (result != VK_SUCCESS)
+			THROW("failed to create readback command pool with error: " + std::to_string(result))
+
+		_slots.resize(slotCount);
+		for (auto& slot : _slots) {
+			VkBufferCreateInfo bufferInfo = {};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = _size;
+			bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			result = vkCreateBuffer(_device, &bufferInfo, nullptr, &slot.buffer);
+			if (result != VK_SUCCESS)
+				THROW("failed to create readback buffer with error: " + std::to_string(result))
+
+			// cached memory makes the CPU reads fast, coherent memory saves the invalidate
+			slot.memory = _allocator->bind(slot.buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+
+			VkCommandBufferAllocateInfo commandBufferInfo = {};
+			commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			commandBufferInfo.commandPool = _commandPool;
+			commandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			commandBufferInfo.commandBufferCount = 1;
+
+			result = vkAllocateCommandBuffers(_device, &commandBufferInfo, &slot.commandBuffer);
+			if (result != VK_SUCCESS)
+				THROW("failed to allocate readback command buffer with error: " + std::to_string(result))
+
+			VkFenceCreateInfo fenceInfo = {};
+			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+			result = vkCreateFence(_device, &fenceInfo, nullptr, &slot.fence);
+			if (result != VK_SUCCESS)
+				THROW("failed to create readback fence with error: " + std::to_string(result))
+
+			slot.frame = 0;
+			slot.busy = false;
+		}
+
+		_worker = std::thread(&FrameReadback::work, this);
+	}
+
+	bool FrameReadback::enqueue(VkQueue queue, VkImage image, uint64_t frame)
+	{
+		Slot& slot = _slots[_next];
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (slot.busy) {
+				++_stats.dropped;
+				return false;
+			}
+			slot.busy = true;
+
+			// the sustained rate covers readbacks only, not the setup before the first frame
+			if (!_started) {
+				_start = std::chrono::steady_clock::now();
+				_started = true;
+			}
+		}
+
+		slot.frame = frame;
+		vkResetFences(_device, 1, &slot.fence);
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(slot.commandBuffer, &beginInfo);
+
+		// the render pass leaves the image in TRANSFER_SRC_OPTIMAL and its external
+		// dependency already orders the color writes before this transfer
+		VkBufferImageCopy region = {};
+		region.bufferOffset = 0;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { _extent.width, _extent.height, 1 };
+
+		vkCmdCopyImageToBuffer(slot.commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = slot.buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier(slot.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+			0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+		VkResult result = vkEndCommandBuffer(slot.commandBuffer);
+		if (result != VK_SUCCESS)
+			THROW("failed to record readback command buffer with error: " + std::to_string(result))
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &slot.commandBuffer;
+
+		result = vkQueueSubmit(queue, 1, &submitInfo, slot.fence);
+		if (result != VK_SUCCESS)
+			THROW("failed to submit readback command buffer with error: " + std::to_string(result))
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_pending.push(_next);
+		}
+		_condition.notify_one();
+
+		_next = (_next + 1) % _slots.size();
+		return true;
+	}
+
+	void FrameReadback::work()
+	{
+		for (;;) {
+			size_t index;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_condition.wait(lock, [this] { return _stop || !_pending.empty(); });
+
+				if (_pending.empty())
+					return;
+
+				index = _pending.front();
+				_pending.pop();
+			}
+
+			Slot& slot = _slots[index];
+			vkWaitForFences(_device, 1, &slot.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+			if (_callback)
+				_callback(slot.frame, slot.memory.mapped, _size);
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			slot.busy = false;
+			++_stats.completed;
+			_stats.bytes += _size;
+			_stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+		}
+	}
+
+	FrameReadback::Stats FrameReadback::stats()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _stats;
+	}
+
+	void FrameReadback::clean()
+	{
+		if (_device == VK_NULL_HANDLE)
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_condition.notify_one();
+		_worker.join();
+
+		for (auto& slot : _slots) {
+			vkDestroyFence(_device, slot.fence, nullptr);
+			vkDestroyBuffer(_device, slot.buffer, nullptr);
+			_allocator->free(slot.memory);
+		}
+
+		vkDestroyCommandPool(_device, _commandPool, nullptr);
+		_device = VK_NULL_HANDLE;
+	}
+}
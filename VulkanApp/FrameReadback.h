@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+
+#include "NonCopyable.h"
+#include "MemoryAllocator.h"
+
+namespace core
+{
+	// Ring of host-visible staging buffers the rendered RGBA8 targets are copied into.
+	// Completion is tracked by a worker thread waiting on each slot's fence, so the
+	// render loop never blocks: when every slot is still busy the frame is dropped.
+	class FrameReadback : public util::NonCopyable
+	{
+	public:
+		typedef std::function<void(uint64_t frame, const void* data, VkDeviceSize size)> Callback;
+
+		struct Stats {
+			uint64_t completed = 0;
+			uint64_t dropped = 0;
+			uint64_t bytes = 0;
+			double seconds = 0.;
+		};
+
+		FrameReadback() = default;
+		~FrameReadback() = default;
+
+		void init(VkDevice device, MemoryAllocator& allocator, uint32_t queueFamily,
+			VkExtent2D extent, uint32_t slotCount, const Callback& callback);
+		bool enqueue(VkQueue queue, VkImage image, uint64_t frame);
+		void clean();
+
+		Stats stats();
+
+	private:
+		struct Slot {
+			VkBuffer buffer;
+			MemoryAllocator::Allocation memory;
+			VkCommandBuffer commandBuffer;
+			VkFence fence;
+			uint64_t frame;
+			bool busy;
+		};
+
+		VkDevice _device = VK_NULL_HANDLE;
+		MemoryAllocator* _allocator = nullptr;
+		VkCommandPool _commandPool;
+		VkExtent2D _extent;
+		VkDeviceSize _size;
+
+		std::vector<Slot> _slots;
+		size_t _next = 0;
+
+		Callback _callback;
+		Stats _stats;
+		std::chrono::steady_clock::time_point _start;
+		bool _started = false;
+
+		std::thread _worker;
+		std::mutex _mutex;
+		std::condition_variable _condition;
+		std::queue<size_t> _pending;
+		bool _stop = false;
+
+		void work();
+	};
+}
@@ -0,0 +1,193 @@
+#include "FrustumCuller.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+#endif
+
+namespace core
+{
+	namespace
+	{
+		// padding sphere: no distance reaches -radius, it is culled by the first plane
+		const float PADDING_RADIUS = -std::numeric_limits<float>::max();
+
+		// the SIMD paths evaluate the same expression in the same order, so results match exactly
+		inline bool inside(const glm::vec4 planes[6], float x, float y, float z, float radius)
+		{
+			bool result = true;
+			for (int p = 0; p < 6; ++p)
+				result &= ((x * planes[p].x + y * planes[p].y) + z * planes[p].z) + planes[p].w >= -radius;
+			return result;
+		}
+	}
+
+	void FrustumCuller::clear()
+	{
+		_x.clear();
+		_y.clear();
+		_z.clear();
+		_radius.clear();
+		_count = 0;
+	}
+
+	void FrustumCuller::reserve(size_t count)
+	{
+		count = (count + WIDTH - 1) / WIDTH * WIDTH;
+		_x.reserve(count);
+		_y.reserve(count);
+		_z.reserve(count);
+		_radius.reserve(count);
+	}
+
+	uint32_t FrustumCuller::add(const glm::vec4& sphere)
+	{
+		if (_count == _x.size()) {
+			const size_t padded = _count + WIDTH;
+			_x.resize(padded, 0.f);
+			_y.resize(padded, 0.f);
+			_z.resize(padded, 0.f);
+			_radius.resize(padded, PADDING_RADIUS);
+		}
+
+		const uint32_t index = static_cast<uint32_t>(_count++);
+		set(index, sphere);
+		return index;
+	}
+
+	void FrustumCuller::set(uint32_t index, const glm::vec4& sphere)
+	{
+		_x[index] = sphere.x;
+		_y[index] = sphere.y;
+		_z[index] = sphere.z;
+		_radius[index] = sphere.w;
+	}
+
+	void FrustumCuller::extractPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+	{
+		// clip = M * p, so each clip volume inequality is a combination of M's rows applied to p
+		const glm::mat4 m = glm::transpose(viewProjection);
+		planes[0] = m[3] + m[0];
+		planes[1] = m[3] - m[0];
+		planes[2] = m[3] + m[1];
+		planes[3] = m[3] - m[1];
+		planes[4] = m[2];
+		planes[5] = m[3] - m[2];
+
+		for (int p = 0; p < 6; ++p)
+			planes[p] /= glm::length(glm::vec3(planes[p]));
+	}
+
+	size_t FrustumCuller::cull(const glm::vec4 planes[6], std::vector<uint32_t>& visible) const
+	{
+		visible.resize(_x.size());
+		visible.resize(cullRange(planes, 0, _x.size(), visible.data()));
+		return visible.size();
+	}
+
+	size_t FrustumCuller::cull(const glm::vec4 planes[6], std::vector<uint32_t>& visible, util::JobSystem& jobSystem) const
+	{
+		// every range compacts into its own part of visible, the parts are joined in order afterwards
+		const size_t padded = _x.size();
+		std::vector<size_t> counts((padded + GRAIN - 1) / GRAIN);
+		visible.resize(padded);
+		jobSystem.parallelFor(padded, GRAIN, [&](size_t begin, size_t end) {
+			counts[begin / GRAIN] = cullRange(planes, begin, end, visible.data() + begin);
+		});
+
+		size_t count = 0;
+		for (size_t r = 0; r < counts.size(); ++r) {
+			const auto first = visible.begin() + r * GRAIN;
+			std::copy(first, first + counts[r], visible.begin() + count);
+			count += counts[r];
+		}
+		visible.resize(count);
+		return count;
+	}
+
+	size_t FrustumCuller::cullScalar(const glm::vec4 planes[6], std::vector<uint32_t>& visible) const
+	{
+		visible.clear();
+		for (size_t i = 0; i < _count; ++i)
+			if (inside(planes, _x[i], _y[i], _z[i], _radius[i]))
+				visible.push_back(static_cast<uint32_t>(i));
+		return visible.size();
+	}
+
+	size_t FrustumCuller::cullRange(const glm::vec4 planes[6], size_t begin, size_t end, uint32_t* visible) const
+	{
+		size_t count = 0;
+
+#if defined(__AVX2__)
+		__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; ++p) {
+			planeX[p] = _mm256_set1_ps(planes[p].x);
+			planeY[p] = _mm256_set1_ps(planes[p].y);
+			planeZ[p] = _mm256_set1_ps(planes[p].z);
+			planeW[p] = _mm256_set1_ps(planes[p].w);
+		}
+		const __m256 zero = _mm256_setzero_ps();
+
+		for (size_t i = begin; i < end; i += WIDTH) {
+			const __m256 x = _mm256_loadu_ps(_x.data() + i);
+			const __m256 y = _mm256_loadu_ps(_y.data() + i);
+			const __m256 z = _mm256_loadu_ps(_z.data() + i);
+			const __m256 negativeRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(_radius.data() + i));
+
+			__m256 result = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; ++p) {
+				const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(x, planeX[p]), _mm256_mul_ps(y, planeY[p])), _mm256_mul_ps(z, planeZ[p])), planeW[p]);
+				result = _mm256_and_ps(result, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+			}
+
+			// branchless compaction: every lane writes its index, only the visible ones advance
+			const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(result));
+			for (uint32_t lane = 0; lane < WIDTH; ++lane) {
+				visible[count] = static_cast<uint32_t>(i + lane);
+				count += (mask >> lane) & 1;
+			}
+		}
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; ++p) {
+			planeX[p] = _mm_set1_ps(planes[p].x);
+			planeY[p] = _mm_set1_ps(planes[p].y);
+			planeZ[p] = _mm_set1_ps(planes[p].z);
+			planeW[p] = _mm_set1_ps(planes[p].w);
+		}
+		const __m128 zero = _mm_setzero_ps();
+
+		for (size_t i = begin; i < end; i += WIDTH) {
+			const __m128 x = _mm_loadu_ps(_x.data() + i);
+			const __m128 y = _mm_loadu_ps(_y.data() + i);
+			const __m128 z = _mm_loadu_ps(_z.data() + i);
+			const __m128 negativeRadius = _mm_sub_ps(zero, _mm_loadu_ps(_radius.data() + i));
+
+			__m128 result = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; ++p) {
+				const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p])), _mm_mul_ps(z, planeZ[p])), planeW[p]);
+				result = _mm_and_ps(result, _mm_cmpge_ps(distance, negativeRadius));
+			}
+
+			// branchless compaction: every lane writes its index, only the visible ones advance
+			const uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(result));
+			for (uint32_t lane = 0; lane < WIDTH; ++lane) {
+				visible[count] = static_cast<uint32_t>(i + lane);
+				count += (mask >> lane) & 1;
+			}
+		}
+#else
+		for (size_t i = begin; i < end; ++i)
+			if (inside(planes, _x[i], _y[i], _z[i], _radius[i]))
+				visible[count++] = static_cast<uint32_t>(i);
+#endif
+
+		return count;
+	}
+}
\ No newline at end of file
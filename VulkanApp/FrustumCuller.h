@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "NonCopyable.h"
+#include "JobSystem.h"
+
+namespace core
+{
+	// CPU frustum culling of bounding spheres stored as structure of arrays: one SIMD instruction
+	// tests a plane against WIDTH spheres, 8 with AVX2 and 4 with SSE2. The arrays are padded to a
+	// multiple of WIDTH with spheres that never pass, so the loops have no remainder.
+	class FrustumCuller : public util::NonCopyable
+	{
+	public:
+#if defined(__AVX2__)
+		static constexpr size_t WIDTH = 8;
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		static constexpr size_t WIDTH = 4;
+#else
+		static constexpr size_t WIDTH = 1;
+#endif
+		// spheres per job of the parallel cull, a multiple of WIDTH
+		static constexpr size_t GRAIN = 16384;
+
+		FrustumCuller() = default;
+		~FrustumCuller() = default;
+
+		void clear();
+		void reserve(size_t count);
+		// sphere is xyz center and w radius, returns its index
+		uint32_t add(const glm::vec4& sphere);
+		void set(uint32_t index, const glm::vec4& sphere);
+		size_t size() const { return _count; }
+
+		// normalized planes of the Vulkan clip volume (-w <= x, y <= w, 0 <= z <= w) in the space
+		// viewProjection transforms from, pointing inside
+		static void extractPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+
+		// visible receives the indices of the spheres intersecting the frustum in increasing order,
+		// returns their count
+		size_t cull(const glm::vec4 planes[6], std::vector<uint32_t>& visible) const;
+		size_t cull(const glm::vec4 planes[6], std::vector<uint32_t>& visible, util::JobSystem& jobSystem) const;
+		// one sphere at a time, the reference the SIMD paths must match
+		size_t cullScalar(const glm::vec4 planes[6], std::vector<uint32_t>& visible) const;
+
+	private:
+		std::vector<float> _x;
+		std::vector<float> _y;
+		std::vector<float> _z;
+		std::vector<float> _radius;
+		size_t _count = 0;
+
+		// begin and end are multiples of WIDTH, writes at most end - begin indices
+		size_t cullRange(const glm::vec4 planes[6], size_t begin, size_t end, uint32_t* visible) const;
+	};
+}
\ No newline at end of file
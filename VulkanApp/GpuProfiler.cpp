@@ -0,0 +1,140 @@
+#include "GpuProfiler.h"
+
+#include <string>
+#include <algorithm>
+
+#ifndef _DEBUG
+	#define LOGGING_DISABLE
+#endif
+
+#include "Logging.h"
+#include "Profiler.h"
+
+namespace core
+{
+	void GpuProfiler::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t slotCount, uint32_t maxZones)
+	{
+		_device = device;
+		_maxZones = maxZones;
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		uint32_t queueFamilyCount;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+		const uint32_t validBits = queueFamilies[queueFamily].timestampValidBits;
+		if (!validBits) {
+			LOG(LogWarning, "timestamps are not supported on the graphics queue, GPU profiling disabled")
+			return;
+		}
+
+		_enabled = true;
+		_timestampPeriod = properties.limits.timestampPeriod;
+		_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+		_frames = std::vector<Frame>(slotCount);
+		for (auto& frame : _frames) {
+			VkQueryPoolCreateInfo queryPoolInfo = {};
+			queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryPoolInfo.queryCount = _maxZones * 2;
+
+			VkResult result = vkCreateQueryPool(_device, &queryPoolInfo, nullptr, &frame.queryPool);
+			if (result != VK_SUCCESS)
+				THROW("failed to create timestamp query pool with error: " + std::to_string(result))
+
+			frame.names.resize(_maxZones);
+		}
+	}
+
+	void GpuProfiler::clean()
+	{
+		for (auto& frame : _frames)
+			vkDestroyQueryPool(_device, frame.queryPool, nullptr);
+
+		_frames.clear();
+		_enabled = false;
+	}
+
+	void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t slot)
+	{
+		if (!_enabled)
+			return;
+
+		_slot = slot;
+		Frame& frame = _frames[slot];
+		resolve(frame);
+
+		vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, _maxZones * 2);
+		frame.used.store(0, std::memory_order_relaxed);
+		frame.cpuBegin = util::Singleton<util::Profiler>::instance().now();
+		frame.pending = true;
+	}
+
+	uint32_t GpuProfiler::begin(VkCommandBuffer commandBuffer, const char* name, VkPipelineStageFlagBits stage)
+	{
+		if (!_enabled)
+			return INVALID_ZONE;
+
+		Frame& frame = _frames[_slot];
+		const uint32_t zone = frame.used.fetch_add(1, std::memory_order_relaxed);
+		if (zone >= _maxZones)
+			return INVALID_ZONE;
+
+		frame.names[zone] = name;
+		vkCmdWriteTimestamp(commandBuffer, stage, frame.queryPool, zone * 2);
+		return zone;
+	}
+
+	void GpuProfiler::end(VkCommandBuffer commandBuffer, uint32_t zone, VkPipelineStageFlagBits stage)
+	{
+		if (zone == INVALID_ZONE)
+			return;
+
+		vkCmdWriteTimestamp(commandBuffer, stage, _frames[_slot].queryPool, zone * 2 + 1);
+	}
+
+	void GpuProfiler::resolve(Frame& frame)
+	{
+		if (!frame.pending)
+			return;
+		frame.pending = false;
+
+		const uint32_t count = std::min(frame.used.load(std::memory_order_relaxed), _maxZones);
+		if (!count)
+			return;
+
+		// value and availability for every query, the frame's fence has signaled so nothing waits
+		std::vector<uint64_t> results(count * 2 * 2);
+		vkGetQueryPoolResults(_device, frame.queryPool, 0, count * 2, results.size() * sizeof(uint64_t), results.data(),
+			2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		_zones.clear();
+		const uint64_t origin = results[0];
+		for (uint32_t zone = 0; zone < count; ++zone) {
+			const uint64_t* begin = &results[zone * 4];
+			const uint64_t* end = &results[zone * 4 + 2];
+			if (!begin[1] || !end[1])
+				continue;
+
+			const double beginNanoseconds = ((begin[0] - origin) & _timestampMask) * _timestampPeriod;
+			const double endNanoseconds = ((end[0] - origin) & _timestampMask) * _timestampPeriod;
+			const double milliseconds = (endNanoseconds - beginNanoseconds) / 1e6;
+
+			_zones.push_back({ frame.names[zone], milliseconds });
+
+			Total& total = _totals[frame.names[zone]];
+			total.milliseconds += milliseconds;
+			++total.count;
+
+#ifndef PROFILING_DISABLE
+			// no calibrated timestamps in this Vulkan version: the GPU track starts where the frame was recorded
+			util::Singleton<util::Profiler>::instance().recordTrack(0, frame.names[zone],
+				frame.cpuBegin + static_cast<uint64_t>(beginNanoseconds), frame.cpuBegin + static_cast<uint64_t>(endNanoseconds));
+#endif
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <map>
+#include <string>
+#include <atomic>
+
+#include "NonCopyable.h"
+
+namespace core
+{
+	// Timestamp queries around regions of the frame's command buffers. Every slot (frame in
+	// flight) has its own query pool; its results are read when the slot is recorded again,
+	// after its fence signaled, so the CPU never waits on the GPU to get them.
+	class GpuProfiler : public util::NonCopyable
+	{
+	public:
+		struct Zone {
+			const char* name;
+			double milliseconds;
+		};
+
+		struct Total {
+			double milliseconds = 0.;
+			uint64_t count = 0;
+		};
+
+		GpuProfiler() = default;
+		~GpuProfiler() = default;
+
+		void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t slotCount, uint32_t maxZones = 64);
+		void clean();
+
+		// resolves what the slot measured last time, then resets its queries; outside of a render pass
+		void beginFrame(VkCommandBuffer commandBuffer, uint32_t slot);
+
+		// name must be a string literal; safe to call from several recording threads
+		uint32_t begin(VkCommandBuffer commandBuffer, const char* name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		void end(VkCommandBuffer commandBuffer, uint32_t zone, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+		bool enabled() const { return _enabled; }
+		// zones of the most recently resolved frame
+		const std::vector<Zone>& zones() const { return _zones; }
+		// per zone name over every resolved frame, keyed by content since equal literals may have different addresses
+		const std::map<std::string, Total>& totals() const { return _totals; }
+
+	private:
+		static const uint32_t INVALID_ZONE = ~0u;
+
+		struct Frame {
+			VkQueryPool queryPool = VK_NULL_HANDLE;
+			std::atomic<uint32_t> used { 0 };
+			std::vector<const char*> names;
+			uint64_t cpuBegin = 0;
+			bool pending = false;
+		};
+
+		VkDevice _device = VK_NULL_HANDLE;
+		bool _enabled = false;
+		double _timestampPeriod = 1.;
+		uint64_t _timestampMask = ~0ull;
+		uint32_t _maxZones = 0;
+
+		std::vector<Frame> _frames;
+		uint32_t _slot = 0;
+
+		std::vector<Zone> _zones;
+		std::map<std::string, Total> _totals;
+
+		void resolve(Frame& frame);
+	};
+}
\ No newline at end of file
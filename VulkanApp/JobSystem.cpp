@@ -0,0 +1,241 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace util
+{
+	namespace
+	{
+		// a worker only gets its queue index in the job system that owns it
+		struct CurrentThread {
+			const JobSystem* owner = nullptr;
+			uint32_t index = 0;
+		};
+
+		thread_local CurrentThread currentThread;
+	}
+
+	void JobSystem::init(uint32_t workerCount)
+	{
+		_stop = false;
+
+		_queues.resize(workerCount + 1);
+		for (auto& queue : _queues)
+			queue = std::make_unique<Queue>();
+
+		for (uint32_t i = 1; i <= workerCount; ++i)
+			_workers.emplace_back(&JobSystem::work, this, i);
+	}
+
+	void JobSystem::clean()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_sleepMutex);
+			_stop = true;
+		}
+		_sleepCondition.notify_all();
+
+		for (auto& worker : _workers)
+			worker.join();
+
+		_workers.clear();
+		_queues.clear();
+	}
+
+	uint32_t JobSystem::threadIndex() const
+	{
+		return currentThread.owner == this ? currentThread.index : 0;
+	}
+
+	void JobSystem::run(Task task, Counter* counter)
+	{
+		if (counter)
+			counter->_value.fetch_add(1, std::memory_order_relaxed);
+
+		push({ std::move(task), counter });
+	}
+
+	void JobSystem::runAfter(Counter& dependency, Task task, Counter* counter)
+	{
+		if (counter)
+			counter->_value.fetch_add(1, std::memory_order_relaxed);
+
+		{
+			std::lock_guard<std::mutex> lock(dependency._mutex);
+			if (!dependency.done()) {
+				dependency._continuations.push_back([this, task = std::move(task), counter]() mutable {
+					push({ std::move(task), counter });
+				});
+				return;
+			}
+		}
+
+		push({ std::move(task), counter });
+	}
+
+	void JobSystem::wait(Counter& counter)
+	{
+		const uint32_t index = threadIndex();
+
+		while (!counter.done()) {
+			Job job;
+			if (pop(index, job))
+				execute(job);
+			else
+				std::this_thread::yield();
+		}
+
+		// the exception is taken so the counter can be reused
+		std::exception_ptr exception;
+		{
+			std::lock_guard<std::mutex> lock(counter._mutex);
+			exception.swap(counter._exception);
+		}
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+
+	void JobSystem::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function)
+	{
+		grain = std::max<size_t>(grain, 1);
+		if (count <= grain) {
+			if (count)
+				function(0, count);
+			return;
+		}
+
+		Counter counter;
+		for (size_t begin = grain; begin < count; begin += grain) {
+			const size_t end = std::min(begin + grain, count);
+			run([&function, begin, end] { function(begin, end); }, &counter);
+		}
+
+		// the calling thread takes the first range itself instead of only waiting, the
+		// spawned ranges reference function and counter so they finish before any rethrow
+		try {
+			function(0, grain);
+		}
+		catch (...) {
+			wait(counter);
+			throw;
+		}
+		wait(counter);
+	}
+
+	JobSystem::Stats JobSystem::stats() const
+	{
+		Stats stats;
+		for (const auto& queue : _queues) {
+			stats.executed += queue->executed.load(std::memory_order_relaxed);
+			stats.stolen += queue->stolen.load(std::memory_order_relaxed);
+		}
+		return stats;
+	}
+
+	void JobSystem::push(Job job)
+	{
+		_pending.fetch_add(1, std::memory_order_release);
+
+		Queue& queue = *_queues[threadIndex()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(std::move(job));
+		}
+
+		// taking the lock orders this wake-up after a worker that is about to sleep checked _pending
+		{
+			std::lock_guard<std::mutex> lock(_sleepMutex);
+		}
+		_sleepCondition.notify_one();
+	}
+
+	bool JobSystem::pop(uint32_t index, Job& job)
+	{
+		{
+			Queue& queue = *_queues[index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty()) {
+				job = std::move(queue.jobs.back());
+				queue.jobs.pop_back();
+				_pending.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		const size_t queueCount = _queues.size();
+		for (size_t i = 1; i < queueCount; ++i) {
+			Queue& victim = *_queues[(index + i) % queueCount];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.jobs.empty()) {
+				job = std::move(victim.jobs.front());
+				victim.jobs.pop_front();
+				_pending.fetch_sub(1, std::memory_order_relaxed);
+				_queues[index]->stolen.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void JobSystem::execute(Job& job)
+	{
+		try {
+			job.task();
+		}
+		catch (...) {
+			if (!job.counter)
+				std::terminate();
+
+			std::lock_guard<std::mutex> lock(job.counter->_mutex);
+			if (!job.counter->_exception)
+				job.counter->_exception = std::current_exception();
+		}
+
+		_queues[threadIndex()]->executed.fetch_add(1, std::memory_order_relaxed);
+		finish(job.counter);
+	}
+
+	void JobSystem::finish(Counter* counter)
+	{
+		if (!counter)
+			return;
+
+		uint32_t value = counter->_value.load(std::memory_order_relaxed);
+		while (value > 1)
+			if (counter->_value.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel))
+				return;
+
+		// possibly the last task: reaching zero and taking the continuations must be atomic
+		// for runAfter, and wait() takes the lock too so the counter outlives this scope
+		std::vector<Task> continuations;
+		{
+			std::lock_guard<std::mutex> lock(counter->_mutex);
+			if (counter->_value.fetch_sub(1, std::memory_order_acq_rel) != 1)
+				return;
+			continuations.swap(counter->_continuations);
+		}
+
+		for (auto& continuation : continuations)
+			continuation();
+	}
+
+	void JobSystem::work(uint32_t index)
+	{
+		currentThread = { this, index };
+
+		for (;;) {
+			Job job;
+			if (pop(index, job)) {
+				execute(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(_sleepMutex);
+			_sleepCondition.wait(lock, [this] { return _stop || _pending.load(std::memory_order_acquire) > 0; });
+
+			if (_stop)
+				return;
+		}
+	}
+}
\ No newline at end of file
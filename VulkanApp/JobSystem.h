@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <exception>
+
+#include "NonCopyable.h"
+
+namespace util
+{
+	// Work-stealing task scheduler. Every worker owns a deque: it pushes and pops its
+	// own tasks at the back and steals from the front of the others. Threads that are not
+	// workers (the main thread) share an extra deque and help running tasks while they wait.
+	class JobSystem : public NonCopyable
+	{
+	public:
+		typedef std::function<void()> Task;
+
+		// Counts the tasks spawned against it that have not finished yet. Tasks can be
+		// made dependent on a counter, they are only scheduled once it reaches zero.
+		// A throwing task still finishes its counter, the first exception is rethrown by wait().
+		class Counter : public NonCopyable
+		{
+		public:
+			Counter() = default;
+			~Counter() = default;
+
+			bool done() const { return _value.load(std::memory_order_acquire) == 0; }
+
+		private:
+			friend class JobSystem;
+
+			std::atomic<uint32_t> _value { 0 };
+			std::mutex _mutex;
+			std::vector<Task> _continuations;
+			std::exception_ptr _exception;
+		};
+
+		struct Stats {
+			uint64_t executed = 0;
+			uint64_t stolen = 0;
+		};
+
+		JobSystem() = default;
+		~JobSystem() { clean(); }
+
+		void init(uint32_t workerCount);
+		void clean();
+
+		// a task run without a counter has nobody to report to, an exception it throws terminates
+		void run(Task task, Counter* counter = nullptr);
+		void runAfter(Counter& dependency, Task task, Counter* counter = nullptr);
+		// runs tasks until the counter reaches zero, then rethrows the first exception of its tasks
+		void wait(Counter& counter);
+
+		// calls function(begin, end) over [0, count) in ranges of at most grain elements
+		void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function);
+
+		// number of threads that can execute tasks, workers plus the external threads
+		uint32_t threadCount() const { return static_cast<uint32_t>(_queues.size()); }
+		// 0 for external threads and workers of another job system, 1..workers for the workers
+		uint32_t threadIndex() const;
+
+		Stats stats() const;
+
+	private:
+		struct Job {
+			Task task;
+			Counter* counter;
+		};
+
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Job> jobs;
+			std::atomic<uint64_t> executed { 0 };
+			std::atomic<uint64_t> stolen { 0 };
+		};
+
+		std::vector<std::unique_ptr<Queue>> _queues;
+		std::vector<std::thread> _workers;
+
+		std::atomic<uint32_t> _pending { 0 };
+		std::mutex _sleepMutex;
+		std::condition_variable _sleepCondition;
+		bool _stop = false;
+
+		void push(Job job);
+		bool pop(uint32_t index, Job& job);
+		void execute(Job& job);
+		void finish(Counter* counter);
+		void work(uint32_t index);
+	};
+}
\ No newline at end of file
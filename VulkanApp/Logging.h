@@ -22,3 +22,14 @@ LOGGING_DEFINE_OUTPUT(util::log::OutputLevelRunTimeSwitch<util::log::StdOutput>)
 
 #endif
 
+namespace util::log
+{
+	// results rather than diagnostics, such as the output of the benchmarks: unlike LOG it is never compiled out
+	inline StdOutput& report()
+	{
+		static StdOutput output;
+		return output;
+	}
+}
+
+#define REPORT(TEXT) util::log::report() << TEXT << util::Log::endl;
\ No newline at end of file
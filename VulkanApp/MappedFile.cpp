@@ -0,0 +1,101 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace util
+{
+#ifdef _WIN32
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+
+		_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (_file == INVALID_HANDLE_VALUE) {
+			_file = nullptr;
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(_file, &size) || !size.QuadPart) {
+			close();
+			return false;
+		}
+
+		_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (_mapping)
+			_data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+
+		if (!_data) {
+			close();
+			return false;
+		}
+
+		_size = static_cast<size_t>(size.QuadPart);
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (_data)
+			UnmapViewOfFile(_data);
+		if (_mapping)
+			CloseHandle(_mapping);
+		if (_file)
+			CloseHandle(_file);
+
+		_data = nullptr;
+		_size = 0;
+		_mapping = nullptr;
+		_file = nullptr;
+	}
+#else
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+
+		_file = ::open(path.c_str(), O_RDONLY);
+		if (_file < 0)
+			return false;
+
+		struct stat status;
+		if (fstat(_file, &status) || !status.st_size) {
+			close();
+			return false;
+		}
+
+		void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, _file, 0);
+		if (data == MAP_FAILED) {
+			close();
+			return false;
+		}
+
+		// the file is consumed front to back, let the kernel read ahead aggressively
+		madvise(data, static_cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+
+		_data = static_cast<const char*>(data);
+		_size = static_cast<size_t>(status.st_size);
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (_data)
+			munmap(const_cast<char*>(_data), _size);
+		if (_file >= 0)
+			::close(_file);
+
+		_data = nullptr;
+		_size = 0;
+		_file = -1;
+	}
+#endif
+}
\ No newline at end of file
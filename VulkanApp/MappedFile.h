@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+#include "NonCopyable.h"
+
+namespace util
+{
+	// Read-only view of a whole file through the OS page cache: nothing is read until a page is touched
+	// and no copy of the file lives on the heap. The view stays valid until close().
+	class MappedFile : public NonCopyable
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile() { close(); }
+
+		bool open(const std::string& path);
+		void close();
+
+		const char* data() const { return _data; }
+		size_t size() const { return _size; }
+
+	private:
+		const char* _data = nullptr;
+		size_t _size = 0;
+
+#ifdef _WIN32
+		void* _file = nullptr;
+		void* _mapping = nullptr;
+#else
+		int _file = -1;
+#endif
+	};
+}
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+#include <string>
+
+#ifndef _DEBUG
+	#define LOGGING_DISABLE
+#endif
+
+#include "Logging.h"
+
+namespace core
+{
+	void MemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+	{
+		_device = device;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &_memProperties);
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		_bufferImageGranularity = properties.limits.bufferImageGranularity;
+		_maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+		// small heaps (e.g. a 256 MB device-local host-visible window) get smaller blocks so one block never takes it all
+		for (uint32_t i = 0; i < _memProperties.memoryTypeCount; ++i) {
+			const VkDeviceSize heapSize = _memProperties.memoryHeaps[_memProperties.memoryTypes[i].heapIndex].size;
+			_blockSizes[i] = std::min(blockSize, std::max<VkDeviceSize>(heapSize / 8, 1));
+		}
+
+		_pools.resize(_memProperties.memoryTypeCount * 2);
+		_stats = Stats();
+		_dedicatedBytes = 0;
+	}
+
+	void MemoryAllocator::clean()
+	{
+		for (size_t pool = 0; pool < _pools.size(); ++pool) {
+			for (auto& block : _pools[pool]) {
+				if (!block->allocator.empty())
+					LOG(LogWarning, "device memory block of type " << pool / 2 << " still has "
+						<< block->allocator.stats().allocationCount << " live allocations")
+
+				freeDeviceMemory(block->memory, static_cast<uint32_t>(pool / 2));
+			}
+		}
+
+		if (_stats.dedicatedCount)
+			LOG(LogWarning, _stats.dedicatedCount << " dedicated device memory allocations leaked")
+
+		_pools.clear();
+	}
+
+	MemoryAllocator::Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, bool linear,
+		VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred)
+	{
+		Allocation allocation;
+		allocation.memoryType = findMemoryType(requirements.memoryTypeBits, required, preferred);
+		allocation.size = requirements.size;
+
+		const VkDeviceSize blockSize = _blockSizes[allocation.memoryType];
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		++_stats.allocateCalls;
+
+		// large resources would waste most of a block, they get their own memory
+		if (requirements.size > blockSize / 2) {
+			allocation.memory = allocateDeviceMemory(requirements.size, allocation.memoryType, &allocation.mapped);
+			++_stats.dedicatedCount;
+			++_stats.allocationCount;
+			_dedicatedBytes += requirements.size;
+			_stats.used += requirements.size;
+			return allocation;
+		}
+
+		// with no granularity constraint every resource kind shares the same blocks
+		const uint32_t poolIndex = allocation.memoryType * 2 + (linear && _bufferImageGranularity > 1 ? 1 : 0);
+		auto& pool = _pools[poolIndex];
+
+		for (auto& block : pool) {
+			allocation.offset = block->allocator.allocate(requirements.size, requirements.alignment);
+			if (allocation.offset != TlsfAllocator::INVALID_OFFSET) {
+				allocation.block = block.get();
+				break;
+			}
+		}
+
+		if (!allocation.block) {
+			void* mapped;
+			const VkDeviceMemory memory = allocateDeviceMemory(blockSize, allocation.memoryType, &mapped);
+			pool.emplace_back(new Block(memory, mapped, poolIndex, blockSize));
+			++_stats.blockCount;
+
+			allocation.block = pool.back().get();
+			allocation.offset = allocation.block->allocator.allocate(requirements.size, requirements.alignment);
+			if (allocation.offset == TlsfAllocator::INVALID_OFFSET)
+				THROW("failed to sub-allocate " + std::to_string(requirements.size) + " bytes aligned to " + std::to_string(requirements.alignment))
+		}
+
+		allocation.memory = allocation.block->memory;
+		if (allocation.block->mapped)
+			allocation.mapped = static_cast<char*>(allocation.block->mapped) + allocation.offset;
+
+		++_stats.allocationCount;
+		_stats.used += requirements.size;
+		return allocation;
+	}
+
+	void MemoryAllocator::free(const Allocation& allocation)
+	{
+		if (allocation.memory == VK_NULL_HANDLE)
+			return;
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		--_stats.allocationCount;
+		_stats.used -= allocation.size;
+
+		if (!allocation.block) {
+			freeDeviceMemory(allocation.memory, allocation.memoryType);
+			--_stats.dedicatedCount;
+			_dedicatedBytes -= allocation.size;
+			return;
+		}
+
+		Block* block = allocation.block;
+		block->allocator.free(allocation.offset);
+		if (!block->allocator.empty())
+			return;
+
+		// keep a single empty block per pool around so alternating allocate/free does not hit the driver
+		auto& pool = _pools[block->pool];
+		const auto isEmpty = [block](const std::unique_ptr<Block>& other) {
+			return other.get() != block && other->allocator.empty();
+		};
+
+		if (std::none_of(pool.begin(), pool.end(), isEmpty))
+			return;
+
+		freeDeviceMemory(block->memory, block->pool / 2);
+		pool.erase(std::find_if(pool.begin(), pool.end(), [block](const std::unique_ptr<Block>& other) {
+			return other.get() == block;
+		}));
+		--_stats.blockCount;
+	}
+
+	MemoryAllocator::Allocation MemoryAllocator::bind(VkBuffer buffer, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred)
+	{
+		VkMemoryRequirements memRequirements;
+		vkGetBufferMemoryRequirements(_device, buffer, &memRequirements);
+
+		const Allocation allocation = allocate(memRequirements, true, required, preferred);
+
+		VkResult result = vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset);
+		if (result != VK_SUCCESS)
+			THROW("failed to bind buffer memory with error: " + std::to_string(result))
+
+		return allocation;
+	}
+
+	MemoryAllocator::Allocation MemoryAllocator::bind(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred)
+	{
+		VkMemoryRequirements memRequirements;
+		vkGetImageMemoryRequirements(_device, image, &memRequirements);
+
+		const Allocation allocation = allocate(memRequirements, tiling == VK_IMAGE_TILING_LINEAR, required, preferred);
+
+		VkResult result = vkBindImageMemory(_device, image, allocation.memory, allocation.offset);
+		if (result != VK_SUCCESS)
+			THROW("failed to bind image memory with error: " + std::to_string(result))
+
+		return allocation;
+	}
+
+	uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const
+	{
+		const VkMemoryPropertyFlags wanted[] = { required | preferred, required };
+
+		for (const auto& properties : wanted)
+			for (uint32_t i = 0; i < _memProperties.memoryTypeCount; ++i)
+				if ((typeFilter & (1 << i)) && (_memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+					return i;
+
+		THROW("failed to find suitable memory type")
+	}
+
+	MemoryAllocator::Stats MemoryAllocator::stats()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		Stats stats = _stats;
+		stats.reserved = _dedicatedBytes;
+
+		VkDeviceSize freeBytes = 0;
+		for (const auto& pool : _pools)
+			for (const auto& block : pool) {
+				const TlsfAllocator::Stats blockStats = block->allocator.stats();
+				stats.reserved += blockStats.size;
+				stats.freeRangeCount += blockStats.freeRangeCount;
+				stats.largestFreeRange = std::max(stats.largestFreeRange, blockStats.largestFreeRange);
+				freeBytes += blockStats.size - blockStats.used;
+			}
+
+		stats.fragmentation = freeBytes ? 1.f - static_cast<float>(stats.largestFreeRange) / freeBytes : 0.f;
+		return stats;
+	}
+
+	VkDeviceMemory MemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void** mapped)
+	{
+		if (_stats.blockCount + _stats.dedicatedCount >= _maxAllocationCount)
+			THROW("device memory allocation count limit reached: " + std::to_string(_maxAllocationCount))
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryType;
+
+		VkDeviceMemory memory;
+		VkResult result = vkAllocateMemory(_device, &allocInfo, nullptr, &memory);
+		if (result != VK_SUCCESS)
+			THROW("failed to allocate device memory with error: " + std::to_string(result))
+
+		++_stats.deviceAllocateCalls;
+
+		*mapped = nullptr;
+		if (_memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+			result = vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+			if (result != VK_SUCCESS) {
+				vkFreeMemory(_device, memory, nullptr);
+				THROW("failed to map device memory with error: " + std::to_string(result))
+			}
+		}
+
+		return memory;
+	}
+
+	void MemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, uint32_t memoryType)
+	{
+		if (_memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+			vkUnmapMemory(_device, memory);
+
+		vkFreeMemory(_device, memory, nullptr);
+	}
+}
\ No newline at end of file
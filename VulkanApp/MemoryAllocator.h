@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include "NonCopyable.h"
+#include "TlsfAllocator.h"
+
+namespace core
+{
+	// Device memory allocator: resources are sub-allocated from large VkDeviceMemory blocks,
+	// one list of blocks per memory type, instead of one vkAllocateMemory each. When the device
+	// has a bufferImageGranularity above 1, linear resources (buffers, linear images) and optimal
+	// images get separate blocks so they never share a granularity page. Host-visible blocks
+	// stay mapped for their whole lifetime.
+	class MemoryAllocator : public util::NonCopyable
+	{
+		struct Block;
+
+	public:
+		static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+		struct Allocation {
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			void* mapped = nullptr;
+			uint32_t memoryType = 0;
+			Block* block = nullptr;		// null for dedicated allocations
+		};
+
+		struct Stats {
+			uint64_t blockCount = 0;
+			uint64_t dedicatedCount = 0;
+			uint64_t allocationCount = 0;
+			uint64_t deviceAllocateCalls = 0;
+			uint64_t allocateCalls = 0;
+			VkDeviceSize reserved = 0;
+			VkDeviceSize used = 0;
+			uint64_t freeRangeCount = 0;
+			VkDeviceSize largestFreeRange = 0;
+			float fragmentation = 0.f;	// 1 - largest free range / free bytes, over all blocks
+		};
+
+		MemoryAllocator() = default;
+		~MemoryAllocator() = default;
+
+		void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+		void clean();
+
+		Allocation allocate(const VkMemoryRequirements& requirements, bool linear,
+			VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+		void free(const Allocation& allocation);
+
+		Allocation bind(VkBuffer buffer, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+		Allocation bind(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) const;
+		Stats stats();
+
+	private:
+		struct Block {
+			VkDeviceMemory memory;
+			void* mapped;
+			uint32_t pool;
+			TlsfAllocator allocator;
+
+			Block(VkDeviceMemory memory, void* mapped, uint32_t pool, VkDeviceSize size) :
+				memory(memory), mapped(mapped), pool(pool), allocator(size) {}
+		};
+
+		VkDevice _device = VK_NULL_HANDLE;
+		VkPhysicalDeviceMemoryProperties _memProperties;
+		VkDeviceSize _bufferImageGranularity;
+		uint32_t _maxAllocationCount;
+		VkDeviceSize _blockSizes[VK_MAX_MEMORY_TYPES];
+
+		// indexed by memory type * 2 + linear
+		std::vector<std::vector<std::unique_ptr<Block>>> _pools;
+		Stats _stats;
+		VkDeviceSize _dedicatedBytes = 0;
+		std::mutex _mutex;
+
+		VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void** mapped);
+		void freeDeviceMemory(VkDeviceMemory memory, uint32_t memoryType);
+	};
+}
\ No newline at end of file
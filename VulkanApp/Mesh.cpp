@@ -0,0 +1,98 @@
+#include "Mesh.h"
+
+#include <algorithm>
+#include <string>
+
+#ifndef _DEBUG
+	#define LOGGING_DISABLE
+#endif
+
+#include "Logging.h"
+
+namespace core
+{
+	void Mesh::init(VkDevice device, MemoryAllocator& allocator, const VertexInputDescription& description,
+		uint32_t vertexCount, uint32_t indexCount)
+	{
+		_device = device;
+		_allocator = &allocator;
+		_vertexCount = vertexCount;
+		_indexCount = indexCount;
+		_vertexSize = static_cast<VkDeviceSize>(vertexCount) * description.vertexSize;
+		_indexOffset = (_vertexSize + 3) / 4 * 4;
+		_streamed = 0;
+
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size();
+		bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkResult result = vkCreateBuffer(_device, &bufferInfo, nullptr, &_buffer);
+		if (result != VK_SUCCESS)
+			THROW("failed to create mesh buffer with error: " + std::to_string(result))
+
+		_memory = _allocator->bind(_buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		_streamBuffers.assign(description.streamOffsets.size(), _buffer);
+		_streamOffsets.clear();
+		for (const auto& streamOffset : description.streamOffsets)
+			_streamOffsets.push_back(static_cast<VkDeviceSize>(vertexCount) * streamOffset);
+	}
+
+	void Mesh::clean()
+	{
+		if (_device == VK_NULL_HANDLE)
+			return;
+
+		vkDestroyBuffer(_device, _buffer, nullptr);
+		_allocator->free(_memory);
+		_device = VK_NULL_HANDLE;
+	}
+
+	bool Mesh::upload(UploadManager& uploads, const void* vertices, const uint32_t* indices)
+	{
+		stream(vertices, indices);
+		return update(uploads, size());
+	}
+
+	void Mesh::stream(const void* vertices, const uint32_t* indices)
+	{
+		_vertexSource = static_cast<const char*>(vertices);
+		_indexSource = reinterpret_cast<const char*>(indices);
+		_streamed = 0;
+	}
+
+	bool Mesh::update(UploadManager& uploads, VkDeviceSize budget)
+	{
+		// vertex bytes first, then index bytes, continuing where the last update stopped
+		while (budget && !ready()) {
+			const bool vertices = _streamed < _vertexSize;
+			const VkDeviceSize begin = vertices ? _streamed : _streamed - _vertexSize;
+			const VkDeviceSize end = vertices ? _vertexSize : indexSize();
+			const VkDeviceSize size = std::min(end - begin, budget);
+			const char* source = vertices ? _vertexSource : _indexSource;
+
+			if (!uploads.upload(_buffer, (vertices ? 0 : _indexOffset) + begin, source + begin, size))
+				return false;
+
+			_streamed += size;
+			budget -= size;
+		}
+
+		return ready();
+	}
+
+	void Mesh::bind(VkCommandBuffer commandBuffer, uint32_t streamCount) const
+	{
+		streamCount = std::min(streamCount, static_cast<uint32_t>(_streamBuffers.size()));
+
+		vkCmdBindVertexBuffers(commandBuffer, 0, streamCount, _streamBuffers.data(), _streamOffsets.data());
+		vkCmdBindIndexBuffer(commandBuffer, _buffer, _indexOffset, VK_INDEX_TYPE_UINT32);
+	}
+
+	void Mesh::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance) const
+	{
+		vkCmdDrawIndexed(commandBuffer, _indexCount, instanceCount, 0, 0, firstInstance);
+	}
+}
\ No newline at end of file
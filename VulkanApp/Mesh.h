@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+#include "NonCopyable.h"
+#include "VertexFormat.h"
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+
+namespace core
+{
+	// Indexed geometry in one device-local buffer: the vertex streams of the description's
+	// layout followed by 32 bit indices. Data goes through the upload ring, so it is usable
+	// by any command buffer recorded after the upload has been flushed.
+	class Mesh : public util::NonCopyable
+	{
+	public:
+		Mesh() = default;
+		~Mesh() = default;
+
+		void init(VkDevice device, MemoryAllocator& allocator, const VertexInputDescription& description,
+			uint32_t vertexCount, uint32_t indexCount);
+		void clean();
+
+		// vertices are laid out as the description says: interleaved, or the streams one after the other
+		bool upload(UploadManager& uploads, const void* vertices, const uint32_t* indices);
+
+		// Spreads the upload over frames: stream() only records the sources, which must stay valid
+		// until ready(), and every update() queues at most budget bytes of what is left. The mesh
+		// can be drawn in any frame recorded after the update that made it ready.
+		void stream(const void* vertices, const uint32_t* indices);
+		bool update(UploadManager& uploads, VkDeviceSize budget);
+		bool ready() const { return _streamed == _vertexSize + indexSize(); }
+
+		// streamCount below the binding count binds only the first streams of a deinterleaved mesh,
+		// e.g. positions for a depth pass
+		void bind(VkCommandBuffer commandBuffer, uint32_t streamCount = ~0u) const;
+		void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0) const;
+
+		uint32_t vertexCount() const { return _vertexCount; }
+		uint32_t indexCount() const { return _indexCount; }
+		uint32_t streamCount() const { return static_cast<uint32_t>(_streamBuffers.size()); }
+		VkDeviceSize size() const { return _indexOffset + indexSize(); }
+
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+		MemoryAllocator* _allocator = nullptr;
+		VkBuffer _buffer;
+		MemoryAllocator::Allocation _memory;
+
+		uint32_t _vertexCount;
+		uint32_t _indexCount;
+		VkDeviceSize _vertexSize;
+		VkDeviceSize _indexOffset;
+		std::vector<VkBuffer> _streamBuffers;
+		std::vector<VkDeviceSize> _streamOffsets;
+
+		const char* _vertexSource = nullptr;
+		const char* _indexSource = nullptr;
+		VkDeviceSize _streamed = 0;
+
+		VkDeviceSize indexSize() const { return static_cast<VkDeviceSize>(_indexCount) * sizeof(uint32_t); }
+	};
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "MeshConverter.h"
+#include "MeshOptimizer.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+
+#ifndef _DEBUG
+	#define LOGGING_DISABLE
+#endif
+
+#include "Logging.h"
+
+namespace core
+{
+	namespace
+	{
+		MeshFile::Bounds computeBounds(const std::vector<glm::vec3>& positions, const uint32_t* indices, uint32_t indexCount)
+		{
+			glm::vec3 min(std::numeric_limits<float>::max());
+			glm::vec3 max(std::numeric_limits<float>::lowest());
+			for (uint32_t i = 0; i < indexCount; ++i) {
+				min = glm::min(min, positions[indices[i]]);
+				max = glm::max(max, positions[indices[i]]);
+			}
+
+			if (!indexCount)
+				min = max = glm::vec3(0.f);
+
+			return { { min.x, min.y, min.z }, { max.x, max.y, max.z } };
+		}
+	}
+
+	bool MeshConverter::loadObj(const std::string& path, SourceMesh& mesh)
+	{
+		std::ifstream file(path);
+		if (!file.is_open()) {
+			LOG(LogWarning, "failed to open " << path)
+			return false;
+		}
+
+		mesh = SourceMesh();
+		std::vector<bool> colored;
+
+		const auto closeSubmesh = [&mesh] {
+			const uint32_t firstIndex = mesh.submeshes.empty() ? 0
+				: mesh.submeshes.back().firstIndex + mesh.submeshes.back().indexCount;
+			const uint32_t indexCount = static_cast<uint32_t>(mesh.indices.size()) - firstIndex;
+			if (indexCount)
+				mesh.submeshes.push_back({ firstIndex, indexCount, {} });
+		};
+
+		std::string line;
+		std::vector<uint32_t> polygon;
+		for (size_t lineNumber = 1; std::getline(file, line); ++lineNumber) {
+			std::istringstream stream(line);
+			std::string keyword;
+			stream >> keyword;
+
+			if (keyword == "v") {
+				glm::vec3 position, color;
+				stream >> position.x >> position.y >> position.z;
+				if (stream.fail()) {
+					LOG(LogWarning, path << ":" << lineNumber << ": malformed vertex")
+					return false;
+				}
+
+				stream >> color.r >> color.g >> color.b;
+				mesh.positions.push_back(position);
+				mesh.colors.push_back(stream.fail() ? glm::vec3(0.f) : color);
+				colored.push_back(!stream.fail());
+			}
+			else if (keyword == "f") {
+				// "i", "i/t", "i//n" or "i/t/n", negative indices count back from the last vertex
+				polygon.clear();
+				std::string corner;
+				while (stream >> corner) {
+					const long index = std::strtol(corner.c_str(), nullptr, 10);
+					const long resolved = index < 0 ? static_cast<long>(mesh.positions.size()) + index : index - 1;
+					if (!index || resolved < 0 || resolved >= static_cast<long>(mesh.positions.size())) {
+						LOG(LogWarning, path << ":" << lineNumber << ": face references a missing vertex")
+						return false;
+					}
+					polygon.push_back(static_cast<uint32_t>(resolved));
+				}
+
+				for (size_t i = 2; i < polygon.size(); ++i)
+					mesh.indices.insert(mesh.indices.end(), { polygon[0], polygon[i - 1], polygon[i] });
+			}
+			else if (keyword == "o" || keyword == "g" || keyword == "usemtl")
+				closeSubmesh();
+		}
+		closeSubmesh();
+
+		if (mesh.indices.empty()) {
+			LOG(LogWarning, path << " has no faces")
+			return false;
+		}
+
+		for (auto& submesh : mesh.submeshes)
+			submesh.bounds = computeBounds(mesh.positions, &mesh.indices[submesh.firstIndex], submesh.indexCount);
+		mesh.bounds = computeBounds(mesh.positions, mesh.indices.data(), static_cast<uint32_t>(mesh.indices.size()));
+
+		const glm::vec3 min(mesh.bounds.min[0], mesh.bounds.min[1], mesh.bounds.min[2]);
+		const glm::vec3 extent = glm::max(glm::vec3(mesh.bounds.max[0], mesh.bounds.max[1], mesh.bounds.max[2]) - min, glm::vec3(1e-6f));
+		for (size_t i = 0; i < mesh.positions.size(); ++i)
+			if (!colored[i])
+				mesh.colors[i] = (mesh.positions[i] - min) / extent;
+
+		return true;
+	}
+
+	void MeshConverter::optimizeSubmesh(SourceMesh& mesh, size_t submesh)
+	{
+		const MeshFile::Submesh& range = mesh.submeshes[submesh];
+		MeshOptimizer::optimizeOverdraw(&mesh.indices[range.firstIndex], range.indexCount, mesh.positions.data(),
+			static_cast<uint32_t>(mesh.positions.size()));
+	}
+
+	void MeshConverter::optimizeVertexFetch(SourceMesh& mesh)
+	{
+		uint32_t usedCount;
+		const std::vector<uint32_t> remap = MeshOptimizer::optimizeVertexFetch(mesh.indices.data(), mesh.indices.size(),
+			static_cast<uint32_t>(mesh.positions.size()), usedCount);
+		MeshOptimizer::remapVertices(mesh.positions, remap, usedCount);
+		MeshOptimizer::remapVertices(mesh.colors, remap, usedCount);
+	}
+
+	void MeshConverter::buildMeshlets(SourceMesh& mesh)
+	{
+		mesh.meshlets.clear();
+		for (const auto& submesh : mesh.submeshes)
+			MeshletBuilder::build(&mesh.indices[submesh.firstIndex], submesh.indexCount, mesh.positions.data(),
+				static_cast<uint32_t>(mesh.positions.size()), submesh.firstIndex, mesh.meshlets);
+	}
+}
\ No newline at end of file
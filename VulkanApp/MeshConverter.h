@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "MeshFile.h"
+
+namespace core
+{
+	// Source geometry for the mesh file converter, before it is packed into a vertex format.
+	struct SourceMesh {
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> colors;
+		std::vector<uint32_t> indices;
+		std::vector<MeshFile::Submesh> submeshes;
+		std::vector<Meshlet> meshlets;
+		MeshFile::Bounds bounds;
+	};
+
+	namespace MeshConverter
+	{
+		// Reads the subset of Wavefront OBJ the app can draw: positions with optional per vertex
+		// colors ("v x y z [r g b]") and polygon faces, which are fanned into triangles. Texture
+		// coordinates and normals are skipped. Every o, g or usemtl starts a new submesh. Vertices
+		// without a color get one from their position in the bounding box.
+		bool loadObj(const std::string& path, SourceMesh& mesh);
+
+		// Triangle order for the vertex cache and overdraw, within one submesh so their index ranges
+		// stay put. Submeshes only touch their own indices and can be optimized in parallel.
+		void optimizeSubmesh(SourceMesh& mesh, size_t submesh);
+		// Vertex order for fetch locality, after all submeshes are optimized. Drops unused vertices.
+		void optimizeVertexFetch(SourceMesh& mesh);
+		// Cuts every submesh into meshlets, once the index order is final.
+		void buildMeshlets(SourceMesh& mesh);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "MeshFile.h"
+
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+#ifndef _DEBUG
+	#define LOGGING_DISABLE
+#endif
+
+#include "Logging.h"
+
+namespace core
+{
+	namespace
+	{
+		const char MAGIC[4] = { 'V', 'K', 'M', 'F' };
+
+		uint64_t align(uint64_t offset)
+		{
+			return (offset + MeshFile::SECTION_ALIGNMENT - 1) / MeshFile::SECTION_ALIGNMENT * MeshFile::SECTION_ALIGNMENT;
+		}
+
+		bool inside(const MeshFile::Section& section, uint64_t expectedSize, size_t fileSize)
+		{
+			return section.offset % MeshFile::SECTION_ALIGNMENT == 0 && section.size == expectedSize
+				&& section.offset <= fileSize && section.size <= fileSize - section.offset;
+		}
+	}
+
+	bool MeshFile::map(const std::string& path)
+	{
+		close();
+
+		if (!_mapped.open(path))
+			return false;
+
+		_data = _mapped.data();
+		_size = _mapped.size();
+		return validate(path);
+	}
+
+	bool MeshFile::read(const std::string& path)
+	{
+		close();
+
+		std::ifstream file(path, std::ios::ate | std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		_copy.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(_copy.data(), _copy.size());
+		if (!file)
+			return false;
+
+		_data = _copy.data();
+		_size = _copy.size();
+		return validate(path);
+	}
+
+	void MeshFile::close()
+	{
+		_mapped.close();
+		std::vector<char>().swap(_copy);
+		_data = nullptr;
+		_size = 0;
+	}
+
+	bool MeshFile::validate(const std::string& path)
+	{
+		const Header& header = *reinterpret_cast<const Header*>(_data);
+
+		const bool valid = _size >= sizeof(Header) && !std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) && header.version == VERSION
+			&& header.attributeCount <= MAX_ATTRIBUTES
+			&& inside(header.vertices, static_cast<uint64_t>(header.vertexCount) * header.vertexSize, _size)
+			&& inside(header.indices, static_cast<uint64_t>(header.indexCount) * sizeof(uint32_t), _size)
+			&& inside(header.submeshes, static_cast<uint64_t>(header.submeshCount) * sizeof(Submesh), _size)
+			&& inside(header.meshlets, static_cast<uint64_t>(header.meshletCount) * sizeof(Meshlet), _size);
+
+		if (!valid) {
+			LOG(LogWarning, "invalid or outdated mesh file " << path)
+			close();
+			return false;
+		}
+
+		// the GPU reads through these ranges unchecked, a corrupt file stops here; the message
+		// is built before close() since header points into the file
+		const auto fail = [this, &path](const std::string& message) {
+			close();
+			THROW(message + " in mesh file " + path)
+		};
+
+		const uint32_t* indices = this->indices();
+		for (uint32_t i = 0; i < header.indexCount; ++i)
+			if (indices[i] >= header.vertexCount)
+				fail("index " + std::to_string(i) + " is " + std::to_string(indices[i]) + " but there are only "
+					+ std::to_string(header.vertexCount) + " vertices");
+
+		const Submesh* submeshes = this->submeshes();
+		for (uint32_t i = 0; i < header.submeshCount; ++i)
+			if (static_cast<uint64_t>(submeshes[i].firstIndex) + submeshes[i].indexCount > header.indexCount)
+				fail("submesh " + std::to_string(i) + " ends past the " + std::to_string(header.indexCount) + " indices");
+
+		const Meshlet* meshlets = this->meshlets();
+		for (uint32_t i = 0; i < header.meshletCount; ++i)
+			if (static_cast<uint64_t>(meshlets[i].firstIndex) + meshlets[i].indexCount > header.indexCount)
+				fail("meshlet " + std::to_string(i) + " ends past the " + std::to_string(header.indexCount) + " indices");
+
+		return true;
+	}
+
+	bool MeshFile::matches(const VertexInputDescription& description) const
+	{
+		const Header& header = this->header();
+		if (header.layout != static_cast<uint32_t>(description.layout) || header.vertexSize != description.vertexSize
+			|| header.attributeCount != description.attributes.size())
+			return false;
+
+		for (uint32_t i = 0; i < header.attributeCount; ++i)
+			if (header.attributeFormats[i] != static_cast<uint32_t>(description.attributes[i].format))
+				return false;
+
+		return true;
+	}
+
+	bool MeshFile::write(const std::string& path, const VertexInputDescription& description, uint32_t vertexCount, const void* vertices,
+		const std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes, const std::vector<Meshlet>& meshlets,
+		const Bounds& bounds)
+	{
+		if (description.attributes.size() > MAX_ATTRIBUTES)
+			return false;
+
+		Header header = {};
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.layout = static_cast<uint32_t>(description.layout);
+		header.attributeCount = static_cast<uint32_t>(description.attributes.size());
+		for (uint32_t i = 0; i < header.attributeCount; ++i)
+			header.attributeFormats[i] = static_cast<uint32_t>(description.attributes[i].format);
+		header.vertexSize = description.vertexSize;
+		header.vertexCount = vertexCount;
+		header.indexCount = static_cast<uint32_t>(indices.size());
+		header.submeshCount = static_cast<uint32_t>(submeshes.size());
+		header.meshletCount = static_cast<uint32_t>(meshlets.size());
+		header.bounds = bounds;
+
+		header.vertices = { align(sizeof(Header)), static_cast<uint64_t>(vertexCount) * description.vertexSize };
+		header.indices = { align(header.vertices.offset + header.vertices.size), indices.size() * sizeof(uint32_t) };
+		header.submeshes = { align(header.indices.offset + header.indices.size), submeshes.size() * sizeof(Submesh) };
+		header.meshlets = { align(header.submeshes.offset + header.submeshes.size), meshlets.size() * sizeof(Meshlet) };
+
+		// same as the pipeline cache, a crash never leaves a truncated file behind
+		const std::string tmpPath = path + ".tmp";
+		{
+			std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+
+			const auto writeSection = [&file](const Section& section, const void* data) {
+				const std::vector<char> padding(static_cast<size_t>(section.offset - file.tellp()), 0);
+				file.write(padding.data(), padding.size());
+				file.write(static_cast<const char*>(data), section.size);
+			};
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			writeSection(header.vertices, vertices);
+			writeSection(header.indices, indices.data());
+			writeSection(header.submeshes, submeshes.data());
+			writeSection(header.meshlets, meshlets.data());
+			file.flush();
+
+			if (!file) {
+				LOG(LogWarning, "failed to write mesh file " << tmpPath)
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tmpPath, path, error);
+		if (error) {
+			LOG(LogWarning, "failed to replace mesh file " << path << ": " << error.message())
+			return false;
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "NonCopyable.h"
+#include "MappedFile.h"
+#include "VertexFormat.h"
+#include "Meshlet.h"
+
+namespace core
+{
+	// Versioned binary mesh container. Every section starts on a SECTION_ALIGNMENT boundary and
+	// holds the data exactly as the GPU reads it (the vertex streams in the recorded layout and
+	// formats, 32 bit indices), so a loaded file is handed to the upload ring as is. Files are
+	// memory mapped by default, read() into a heap copy is kept to compare against.
+	class MeshFile : public util::NonCopyable
+	{
+	public:
+		static constexpr uint32_t VERSION = 2;
+		static constexpr uint32_t SECTION_ALIGNMENT = 256;
+		static constexpr uint32_t MAX_ATTRIBUTES = 8;
+
+		struct Bounds {
+			float min[3];
+			float max[3];
+		};
+
+		struct Submesh {
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			Bounds bounds;
+		};
+
+		struct Section {
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		struct Header {
+			char magic[4];
+			uint32_t version;
+			uint32_t layout;
+			uint32_t attributeCount;
+			uint32_t attributeFormats[MAX_ATTRIBUTES];
+			uint32_t vertexSize;
+			uint32_t vertexCount;
+			uint32_t indexCount;
+			uint32_t submeshCount;
+			uint32_t meshletCount;
+			Section vertices;
+			Section indices;
+			Section submeshes;
+			Section meshlets;
+			Bounds bounds;
+		};
+
+		MeshFile() = default;
+		~MeshFile() = default;
+
+		bool map(const std::string& path);
+		bool read(const std::string& path);
+		void close();
+
+		bool matches(const VertexInputDescription& description) const;
+
+		const Header& header() const { return *reinterpret_cast<const Header*>(_data); }
+		const void* vertices() const { return _data + header().vertices.offset; }
+		const uint32_t* indices() const { return reinterpret_cast<const uint32_t*>(_data + header().indices.offset); }
+		const Submesh* submeshes() const { return reinterpret_cast<const Submesh*>(_data + header().submeshes.offset); }
+		const Meshlet* meshlets() const { return reinterpret_cast<const Meshlet*>(_data + header().meshlets.offset); }
+		size_t size() const { return _size; }
+
+		static bool write(const std::string& path, const VertexInputDescription& description, uint32_t vertexCount, const void* vertices,
+			const std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes, const std::vector<Meshlet>& meshlets,
+			const Bounds& bounds);
+
+	private:
+		util::MappedFile _mapped;
+		std::vector<char> _copy;
+		const char* _data = nullptr;
+		size_t _size = 0;
+
+		// false for a wrong magic, version or section layout, throws on indices or index ranges out of bounds
+		bool validate(const std::string& path);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,259 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+
+namespace core
+{
+	namespace
+	{
+		// FIFO post-transform cache: a vertex is in the cache while fewer than cacheSize
+		// misses happened since it was loaded
+		class VertexCache
+		{
+		public:
+			VertexCache(uint32_t vertexCount, uint32_t cacheSize)
+				: _loaded(vertexCount, 0), _cacheSize(cacheSize) {}
+
+			bool access(uint32_t vertex)
+			{
+				if (_loaded[vertex] && _misses - _loaded[vertex] < _cacheSize)
+					return true;
+
+				_loaded[vertex] = ++_misses;
+				return false;
+			}
+
+			// empties the cache without touching every entry
+			void reset() { _misses += _cacheSize; }
+
+		private:
+			std::vector<uint32_t> _loaded;
+			uint32_t _misses = 0;
+			uint32_t _cacheSize;
+		};
+	}
+
+	MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const uint32_t* indices, size_t indexCount, uint32_t vertexCount,
+		uint32_t cacheSize)
+	{
+		CacheStats stats;
+		VertexCache cache(vertexCount, cacheSize);
+		std::vector<bool> referenced(vertexCount, false);
+
+		for (size_t i = 0; i < indexCount; ++i) {
+			if (!cache.access(indices[i]))
+				++stats.transformCount;
+			if (!referenced[indices[i]]) {
+				referenced[indices[i]] = true;
+				++stats.vertexCount;
+			}
+		}
+
+		stats.triangleCount = static_cast<uint32_t>(indexCount / 3);
+		stats.acmr = stats.triangleCount ? static_cast<float>(stats.transformCount) / stats.triangleCount : 0.f;
+		stats.atvr = stats.vertexCount ? static_cast<float>(stats.transformCount) / stats.vertexCount : 0.f;
+		return stats;
+	}
+
+	void MeshOptimizer::optimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize,
+		std::vector<uint32_t>* clusters)
+	{
+		const size_t triangleCount = indexCount / 3;
+
+		// triangles around every vertex, as offsets into one array
+		std::vector<uint32_t> liveCount(vertexCount, 0);
+		for (size_t i = 0; i < indexCount; ++i)
+			++liveCount[indices[i]];
+
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveCount[v];
+
+		std::vector<uint32_t> adjacency(indexCount);
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indexCount; ++i)
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> deadEnds;
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> output;
+		output.reserve(indexCount);
+
+		uint32_t time = cacheSize + 1;
+		uint32_t cursor = 0;
+
+		// the most recently touched vertex with triangles left, or the next one in input order
+		const auto skipDeadEnd = [&]() -> int64_t {
+			while (!deadEnds.empty()) {
+				const uint32_t vertex = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveCount[vertex])
+					return vertex;
+			}
+			for (; cursor < vertexCount; ++cursor)
+				if (liveCount[cursor])
+					return cursor;
+			return -1;
+		};
+
+		int64_t fan = skipDeadEnd();
+		while (fan >= 0) {
+			candidates.clear();
+
+			for (uint32_t a = adjacencyOffsets[fan]; a < adjacencyOffsets[fan + 1]; ++a) {
+				const uint32_t triangle = adjacency[a];
+				if (emitted[triangle])
+					continue;
+
+				for (uint32_t k = 0; k < 3; ++k) {
+					const uint32_t vertex = indices[triangle * 3 + k];
+					output.push_back(vertex);
+					deadEnds.push_back(vertex);
+					candidates.push_back(vertex);
+					--liveCount[vertex];
+					if (time - cacheTime[vertex] > cacheSize)
+						cacheTime[vertex] = time++;
+				}
+				emitted[triangle] = true;
+			}
+
+			// prefer the candidate that entered the cache first but will still be in it after its fan
+			int64_t next = -1;
+			int64_t best = -1;
+			for (const uint32_t vertex : candidates) {
+				if (!liveCount[vertex])
+					continue;
+
+				int64_t priority = 0;
+				if (time - cacheTime[vertex] + 2 * liveCount[vertex] <= cacheSize)
+					priority = time - cacheTime[vertex];
+				if (priority > best) {
+					best = priority;
+					next = vertex;
+				}
+			}
+
+			if (next < 0) {
+				next = skipDeadEnd();
+				if (clusters && next >= 0)
+					clusters->push_back(static_cast<uint32_t>(output.size() / 3));
+			}
+			fan = next;
+		}
+
+		if (clusters)
+			clusters->insert(clusters->begin(), 0);
+
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	void MeshOptimizer::optimizeOverdraw(uint32_t* indices, size_t indexCount, const glm::vec3* positions, uint32_t vertexCount,
+		uint32_t cacheSize, float threshold)
+	{
+		const uint32_t triangleCount = static_cast<uint32_t>(indexCount / 3);
+		if (!triangleCount)
+			return;
+
+		std::vector<uint32_t> hardBoundaries;
+		optimizeVertexCache(indices, indexCount, vertexCount, cacheSize, &hardBoundaries);
+		hardBoundaries.push_back(triangleCount);
+
+		// cut every cluster where the part so far is nearly as cache efficient as the whole cluster
+		std::vector<uint32_t> boundaries;
+		VertexCache cache(vertexCount, cacheSize);
+		for (size_t c = 0; c + 1 < hardBoundaries.size(); ++c) {
+			const uint32_t begin = hardBoundaries[c];
+			const uint32_t end = hardBoundaries[c + 1];
+
+			cache.reset();
+			uint32_t clusterMisses = 0;
+			for (uint32_t i = begin * 3; i < end * 3; ++i)
+				clusterMisses += !cache.access(indices[i]);
+			const float clusterThreshold = threshold * clusterMisses / (end - begin);
+
+			cache.reset();
+			uint32_t start = begin;
+			uint32_t misses = 0;
+			boundaries.push_back(begin);
+			for (uint32_t t = begin; t < end; ++t) {
+				for (uint32_t k = 0; k < 3; ++k)
+					misses += !cache.access(indices[t * 3 + k]);
+
+				if (t + 1 < end && misses <= clusterThreshold * (t + 1 - start)) {
+					boundaries.push_back(t + 1);
+					start = t + 1;
+					misses = 0;
+					cache.reset();
+				}
+			}
+		}
+		boundaries.push_back(triangleCount);
+
+		// area weighted centroids and normals, clusters pointing out of the mesh go first
+		struct Cluster {
+			uint32_t begin;
+			uint32_t end;
+			glm::vec3 centroid;
+			glm::vec3 normal;
+			float area;
+			float sortKey;
+		};
+
+		std::vector<Cluster> sorted(boundaries.size() - 1);
+		glm::vec3 meshCentroid(0.f);
+		float meshArea = 0.f;
+		for (size_t c = 0; c < sorted.size(); ++c) {
+			Cluster& cluster = sorted[c];
+			cluster = { boundaries[c], boundaries[c + 1], glm::vec3(0.f), glm::vec3(0.f), 0.f, 0.f };
+
+			for (uint32_t t = cluster.begin; t < cluster.end; ++t) {
+				const glm::vec3& p0 = positions[indices[t * 3]];
+				const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+				const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+				const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				const float area = glm::length(normal);
+
+				cluster.centroid += (p0 + p1 + p2) * (area / 3.f);
+				cluster.normal += normal;
+				cluster.area += area;
+			}
+
+			meshCentroid += cluster.centroid;
+			meshArea += cluster.area;
+			if (cluster.area > 0.f)
+				cluster.centroid /= cluster.area;
+		}
+		if (meshArea > 0.f)
+			meshCentroid /= meshArea;
+
+		for (auto& cluster : sorted) {
+			const float length = glm::length(cluster.normal);
+			cluster.sortKey = length > 0.f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / length) : 0.f;
+		}
+
+		std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+		std::vector<uint32_t> output;
+		output.reserve(indexCount);
+		for (const auto& cluster : sorted)
+			output.insert(output.end(), indices + cluster.begin * 3, indices + cluster.end * 3);
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	std::vector<uint32_t> MeshOptimizer::optimizeVertexFetch(uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t& usedCount)
+	{
+		std::vector<uint32_t> remap(vertexCount, ~0u);
+		usedCount = 0;
+
+		for (size_t i = 0; i < indexCount; ++i) {
+			uint32_t& vertex = remap[indices[i]];
+			if (vertex == ~0u)
+				vertex = usedCount++;
+			indices[i] = vertex;
+		}
+
+		return remap;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace core
+{
+	// Offline triangle and vertex reordering for indexed triangle lists. Everything works in place
+	// on plain index arrays, is single threaded and depends only on its input, so meshes and
+	// submeshes can be processed in parallel with the same result as a serial run.
+	namespace MeshOptimizer
+	{
+		// post-transform caches are modelled as FIFOs, 16 entries is a conservative size for current GPUs
+		constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+		// a cluster may be cut where its cache efficiency stays within 5% of the uncut cluster
+		constexpr float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+		struct CacheStats {
+			uint32_t triangleCount = 0;
+			uint32_t vertexCount = 0;		// distinct vertices referenced
+			uint32_t transformCount = 0;	// cache misses
+			float acmr = 0.f;				// average cache miss ratio: transforms per triangle, 0.5 at best
+			float atvr = 0.f;				// average transform to vertex ratio: transforms per vertex, 1 at best
+		};
+
+		CacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, uint32_t vertexCount,
+			uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+		// Tipsify (Sander, Nehab, Barczak 2007): fans around the most recently used vertex that is
+		// still in the cache. If clusters is given, it receives the first triangle of every run
+		// that had to restart from a dead end, where the cache holds nothing useful anyway.
+		void optimizeVertexCache(uint32_t* indices, size_t indexCount, uint32_t vertexCount,
+			uint32_t cacheSize = DEFAULT_CACHE_SIZE, std::vector<uint32_t>* clusters = nullptr);
+
+		// Cache-ordered clusters are split further where that costs little cache efficiency, then
+		// sorted so that clusters facing away from the mesh center come first: they are the likely
+		// occluders from any view point. Runs optimizeVertexCache itself.
+		void optimizeOverdraw(uint32_t* indices, size_t indexCount, const glm::vec3* positions, uint32_t vertexCount,
+			uint32_t cacheSize = DEFAULT_CACHE_SIZE, float threshold = DEFAULT_OVERDRAW_THRESHOLD);
+
+		// Renumbers vertices in order of first use so vertex fetch walks memory linearly. Returns
+		// the new index of every vertex, unreferenced vertices map to ~0u and are dropped by remapVertices.
+		std::vector<uint32_t> optimizeVertexFetch(uint32_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t& usedCount);
+
+		template<typename T>
+		void remapVertices(std::vector<T>& vertices, const std::vector<uint32_t>& remap, uint32_t usedCount)
+		{
+			std::vector<T> remapped(usedCount);
+			for (size_t i = 0; i < vertices.size(); ++i)
+				if (remap[i] != ~0u)
+					remapped[remap[i]] = vertices[i];
+			vertices.swap(remapped);
+		}
+	}
+}
\ No newline at end of file
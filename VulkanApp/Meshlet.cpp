@@ -0,0 +1,108 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace core
+{
+	namespace
+	{
+		void computeBounds(Meshlet& meshlet, const uint32_t* indices, const glm::vec3* positions)
+		{
+			const uint32_t triangleCount = meshlet.indexCount / 3;
+
+			glm::vec3 min(std::numeric_limits<float>::max());
+			glm::vec3 max(std::numeric_limits<float>::lowest());
+			for (uint32_t i = 0; i < meshlet.indexCount; ++i) {
+				min = glm::min(min, positions[indices[i]]);
+				max = glm::max(max, positions[indices[i]]);
+			}
+
+			meshlet.center = (min + max) * .5f;
+			meshlet.radius = 0.f;
+			for (uint32_t i = 0; i < meshlet.indexCount; ++i)
+				meshlet.radius = std::max(meshlet.radius, glm::length(positions[indices[i]] - meshlet.center));
+
+			std::vector<glm::vec3> normals;
+			normals.reserve(triangleCount);
+			glm::vec3 axis(0.f);
+			for (uint32_t t = 0; t < triangleCount; ++t) {
+				const glm::vec3& p0 = positions[indices[t * 3]];
+				const glm::vec3 normal = glm::cross(positions[indices[t * 3 + 1]] - p0, positions[indices[t * 3 + 2]] - p0);
+				const float length = glm::length(normal);
+				normals.push_back(length > 0.f ? normal / length : glm::vec3(0.f));
+				axis += normals.back();
+			}
+
+			const float axisLength = glm::length(axis);
+			meshlet.coneAxis = axisLength > 0.f ? axis / axisLength : glm::vec3(0.f, 0.f, 1.f);
+			meshlet.coneApex = meshlet.center;
+			meshlet.coneCutoff = 2.f;
+
+			float minDot = 1.f;
+			for (const auto& normal : normals)
+				if (normal != glm::vec3(0.f))
+					minDot = std::min(minDot, glm::dot(meshlet.coneAxis, normal));
+
+			// past ~84 degrees the cone hardly ever culls and its apex runs off to infinity
+			if (axisLength == 0.f || minDot <= .1f)
+				return;
+
+			// move the apex back along the axis until it is behind every triangle's plane
+			float maxT = 0.f;
+			for (uint32_t t = 0; t < triangleCount; ++t) {
+				if (normals[t] == glm::vec3(0.f))
+					continue;
+				const float distance = glm::dot(meshlet.center - positions[indices[t * 3]], normals[t]);
+				maxT = std::max(maxT, distance / glm::dot(meshlet.coneAxis, normals[t]));
+			}
+
+			meshlet.coneApex = meshlet.center - meshlet.coneAxis * maxT;
+			meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+		}
+	}
+
+	void MeshletBuilder::build(const uint32_t* indices, size_t indexCount, const glm::vec3* positions, uint32_t vertexCount,
+		uint32_t firstIndex, std::vector<Meshlet>& meshlets)
+	{
+		// the meshlet every vertex was last added to, so membership checks need no clearing
+		std::vector<uint32_t> owner(vertexCount, ~0u);
+		Meshlet meshlet = {};
+		uint32_t begin = 0;
+
+		const auto flush = [&](uint32_t end) {
+			meshlet.firstIndex = firstIndex + begin;
+			meshlet.indexCount = end - begin;
+			computeBounds(meshlet, indices + begin, positions);
+			meshlets.push_back(meshlet);
+
+			meshlet = {};
+			begin = end;
+		};
+
+		for (uint32_t i = 0; i < indexCount; i += 3) {
+			// the triangle's vertices that are not in the meshlet yet, counting repeated ones once
+			const auto countAdded = [&] {
+				const uint32_t id = static_cast<uint32_t>(meshlets.size());
+				uint32_t added = 0;
+				for (uint32_t k = 0; k < 3; ++k)
+					added += owner[indices[i + k]] != id && std::find(indices + i, indices + i + k, indices[i + k]) == indices + i + k;
+				return added;
+			};
+
+			uint32_t added = countAdded();
+			if (meshlet.vertexCount + added > Meshlet::MAX_VERTICES || (i - begin) / 3 == Meshlet::MAX_TRIANGLES) {
+				flush(i);
+				added = countAdded();
+			}
+
+			for (uint32_t k = 0; k < 3; ++k)
+				owner[indices[i + k]] = static_cast<uint32_t>(meshlets.size());
+			meshlet.vertexCount += added;
+		}
+
+		if (begin < indexCount)
+			flush(static_cast<uint32_t>(indexCount));
+	}
+}
\ No newline at end of file
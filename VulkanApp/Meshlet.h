@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace core
+{
+	// A cluster of at most MAX_VERTICES vertices and MAX_TRIANGLES triangles that are contiguous in
+	// the mesh's index buffer, with what is needed to cull it on the GPU. The layout matches the
+	// std430 struct of ClusterCulling.comp and is stored as is in mesh files.
+	struct Meshlet {
+		static constexpr uint32_t MAX_VERTICES = 64;
+		static constexpr uint32_t MAX_TRIANGLES = 124;
+
+		glm::vec3 center;		// bounding sphere
+		float radius;
+		glm::vec3 coneApex;		// normal cone: every triangle is back facing for views from inside it
+		float coneCutoff;		// sine of the cone's half angle, above 1 when the normals are too spread out to cull
+		glm::vec3 coneAxis;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t vertexCount;
+		uint32_t padding[2];
+	};
+	static_assert(sizeof(Meshlet) == 64, "Meshlet does not match its std430 layout");
+
+	namespace MeshletBuilder
+	{
+		// Cuts the triangles in index order, which keeps the clusters compact when the indices are
+		// already optimized for the vertex cache. Appends the meshlets, firstIndex is added to their ranges.
+		void build(const uint32_t* indices, size_t indexCount, const glm::vec3* positions, uint32_t vertexCount,
+			uint32_t firstIndex, std::vector<Meshlet>& meshlets);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "ObjectCuller.h"
+
+#include <algorithm>
+#include <string>
+
+#ifndef _DEBUG
+	#define LOGGING_DISABLE
+#endif
+
+#include "Logging.h"
+
+namespace core
+{
+	void ObjectCuller::init(VkDevice device, MemoryAllocator& allocator, VkPipelineCache pipelineCache, const std::vector<char>& shaderCode,
+		uint32_t slotCount, VkBuffer objects, uint32_t objectCount, PFN_vkCmdDrawIndexedIndirectCountAMD drawIndirectCount,
+		bool multiDrawIndirect)
+	{
+		_device = device;
+		_allocator = &allocator;
+		_objectCount = objectCount;
+		_drawIndirectCount = drawIndirectCount;
+		_multiDrawIndirect = multiDrawIndirect;
+		_stats = Stats();
+
+		_pass.init(_device, pipelineCache, shaderCode, 3, sizeof(PushConstants), slotCount);
+
+		_slots.resize(slotCount);
+		for (uint32_t i = 0; i < slotCount; ++i) {
+			Slot& slot = _slots[i];
+			slot.commands = ComputePass::createBuffer(_device, static_cast<VkDeviceSize>(objectCount) * sizeof(VkDrawIndexedIndirectCommand),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+			slot.commandsMemory = _allocator->bind(slot.commands, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+			// read by the draw and, once the slot's fence signaled, by the CPU for the statistics
+			slot.drawCount = ComputePass::createBuffer(_device, sizeof(uint32_t),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+			slot.drawCountMemory = _allocator->bind(slot.drawCount, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			slot.pending = false;
+
+			_pass.setBuffers(i, { objects, slot.commands, slot.drawCount });
+		}
+	}
+
+	void ObjectCuller::clean()
+	{
+		if (_device == VK_NULL_HANDLE)
+			return;
+
+		for (auto& slot : _slots) {
+			vkDestroyBuffer(_device, slot.commands, nullptr);
+			_allocator->free(slot.commandsMemory);
+			vkDestroyBuffer(_device, slot.drawCount, nullptr);
+			_allocator->free(slot.drawCountMemory);
+		}
+		_slots.clear();
+
+		_pass.clean();
+		_device = VK_NULL_HANDLE;
+	}
+
+	void ObjectCuller::cull(VkCommandBuffer commandBuffer, uint32_t slot, const glm::vec4 (&planes)[6])
+	{
+		Slot& current = _slots[slot];
+		if (current.pending)
+			collect(current, _stats);
+
+		// commands past the count are still read by a plain multi-draw, they must draw nothing
+		vkCmdFillBuffer(commandBuffer, current.drawCount, 0, VK_WHOLE_SIZE, 0);
+		if (!_drawIndirectCount)
+			vkCmdFillBuffer(commandBuffer, current.commands, 0, VK_WHOLE_SIZE, 0);
+
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			1, &barrier, 0, nullptr, 0, nullptr);
+
+		PushConstants pushConstants;
+		std::copy(std::begin(planes), std::end(planes), pushConstants.planes);
+		pushConstants.objectCount = _objectCount;
+		_pass.dispatch(commandBuffer, slot, &pushConstants, _objectCount);
+
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+			1, &barrier, 0, nullptr, 0, nullptr);
+
+		current.pending = true;
+	}
+
+	void ObjectCuller::draw(VkCommandBuffer commandBuffer, uint32_t slot) const
+	{
+		const Slot& current = _slots[slot];
+		const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+		if (_drawIndirectCount)
+			_drawIndirectCount(commandBuffer, current.commands, 0, current.drawCount, 0, _objectCount, stride);
+		else if (_multiDrawIndirect)
+			vkCmdDrawIndexedIndirect(commandBuffer, current.commands, 0, _objectCount, stride);
+		else
+			for (uint32_t i = 0; i < _objectCount; ++i)
+				vkCmdDrawIndexedIndirect(commandBuffer, current.commands, static_cast<VkDeviceSize>(i) * stride, 1, stride);
+	}
+
+	ObjectCuller::Stats ObjectCuller::stats() const
+	{
+		Stats stats = _stats;
+		for (const auto& slot : _slots)
+			if (slot.pending)
+				collect(slot, stats);
+
+		return stats;
+	}
+
+	void ObjectCuller::collect(const Slot& slot, Stats& stats) const
+	{
+		++stats.frames;
+		stats.objects += _objectCount;
+		stats.visibleObjects += *static_cast<const uint32_t*>(slot.drawCountMemory.mapped);
+	}
+}
\ No newline at end of file
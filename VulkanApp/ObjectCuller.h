@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "NonCopyable.h"
+#include "MemoryAllocator.h"
+#include "ComputePass.h"
+
+namespace core
+{
+	// One drawable instance of a mesh. The layout matches the std430 struct of ObjectCulling.comp;
+	// the buffer of objects is also bound as an instance-rate vertex buffer for the transform.
+	struct DrawObject {
+		glm::vec4 transform;	// xyz offset, w uniform scale
+		glm::vec4 sphere;		// bounding sphere in mesh space
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t padding[2];
+	};
+	static_assert(sizeof(DrawObject) == 48, "DrawObject does not match its std430 layout");
+
+	// GPU-driven drawing of a buffer of objects: ObjectCulling.comp culls them against the frustum
+	// and compacts an indexed indirect command per visible object, firstInstance being the object's
+	// index, behind an atomic counter. The draw is a single vkCmdDrawIndexedIndirectCountAMD when the
+	// extension is there, else a multi-draw over every command with the unused ones zeroed. The
+	// recorded commands are the same whatever the object count and visibility.
+	class ObjectCuller : public util::NonCopyable
+	{
+	public:
+		struct Stats {
+			uint64_t frames = 0;
+			uint64_t objects = 0;
+			uint64_t visibleObjects = 0;
+		};
+
+		ObjectCuller() = default;
+		~ObjectCuller() = default;
+
+		// drawIndirectCount is null without VK_AMD_draw_indirect_count; without multiDrawIndirect
+		// every command is drawn on its own, which brings back a per-object CPU cost
+		void init(VkDevice device, MemoryAllocator& allocator, VkPipelineCache pipelineCache, const std::vector<char>& shaderCode,
+			uint32_t slotCount, VkBuffer objects, uint32_t objectCount, PFN_vkCmdDrawIndexedIndirectCountAMD drawIndirectCount,
+			bool multiDrawIndirect);
+		void clean();
+
+		// outside of a render pass, planes as for ClusterCuller but in the space of the object transforms
+		void cull(VkCommandBuffer commandBuffer, uint32_t slot, const glm::vec4 (&planes)[6]);
+		// inside the render pass, with the mesh and the objects' instance buffer bound
+		void draw(VkCommandBuffer commandBuffer, uint32_t slot) const;
+
+		// includes the slots still pending, only complete once the device is idle
+		Stats stats() const;
+
+	private:
+		struct PushConstants {
+			glm::vec4 planes[6];
+			uint32_t objectCount;
+		};
+
+		struct Slot {
+			VkBuffer commands;
+			MemoryAllocator::Allocation commandsMemory;
+			VkBuffer drawCount;
+			MemoryAllocator::Allocation drawCountMemory;
+			bool pending;
+		};
+
+		VkDevice _device = VK_NULL_HANDLE;
+		MemoryAllocator* _allocator = nullptr;
+		ComputePass _pass;
+
+		uint32_t _objectCount;
+		PFN_vkCmdDrawIndexedIndirectCountAMD _drawIndirectCount;
+		bool _multiDrawIndirect;
+
+		std::vector<Slot> _slots;
+		Stats _stats;
+
+		void collect(const Slot& slot, Stats& stats) const;
+	};
+}
\ No newline at end of file
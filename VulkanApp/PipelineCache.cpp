@@ -0,0 +1,146 @@
+#include "PipelineCache.h"
+
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+#ifndef _DEBUG
+	#define LOGGING_DISABLE
+#endif
+
+#include "Logging.h"
+
+namespace core
+{
+	void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path)
+	{
+		_device = device;
+		_path = path;
+		vkGetPhysicalDeviceProperties(physicalDevice, &_properties);
+
+		std::vector<char> data;
+		std::ifstream file(_path, std::ios::binary);
+		if (file.is_open()) {
+			FileHeader header;
+			file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+			if (file && header.dataSize < (1ull << 32)) {
+				data.resize(static_cast<size_t>(header.dataSize));
+				file.read(data.data(), data.size());
+
+				if (!file || !isValid(header, data)) {
+					LOG(LogWarning, "discarding stale or corrupted pipeline cache " << _path)
+					data.clear();
+				}
+			}
+		}
+
+		_warm = !data.empty();
+
+		VkPipelineCacheCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		createInfo.initialDataSize = data.size();
+		createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+		VkResult result = vkCreatePipelineCache(_device, &createInfo, nullptr, &_pipelineCache);
+		if (result != VK_SUCCESS)
+			THROW("failed to create pipeline cache with error: " + std::to_string(result))
+	}
+
+	void PipelineCache::save()
+	{
+		size_t size;
+		vkGetPipelineCacheData(_device, _pipelineCache, &size, nullptr);
+
+		std::vector<char> data(size);
+		VkResult result = vkGetPipelineCacheData(_device, _pipelineCache, &size, data.data());
+		if (result != VK_SUCCESS) {
+			LOG(LogWarning, "failed to get pipeline cache data with error: " << result)
+			return;
+		}
+		data.resize(size);
+
+		FileHeader header = makeHeader();
+		header.dataSize = data.size();
+		header.checksum = checksum(data.data(), data.size());
+
+		// write next to the destination then rename, a crash never leaves a truncated cache behind
+		const std::string tmpPath = _path + ".tmp";
+		{
+			std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(data.data(), data.size());
+			file.flush();
+
+			if (!file) {
+				LOG(LogWarning, "failed to write pipeline cache " << tmpPath)
+				return;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tmpPath, _path, error);
+		if (error)
+			LOG(LogWarning, "failed to replace pipeline cache " << _path << ": " << error.message())
+	}
+
+	void PipelineCache::clean()
+	{
+		vkDestroyPipelineCache(_device, _pipelineCache, nullptr);
+		_pipelineCache = VK_NULL_HANDLE;
+	}
+
+	PipelineCache::FileHeader PipelineCache::makeHeader() const
+	{
+		FileHeader header = {};
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.vendorID = _properties.vendorID;
+		header.deviceID = _properties.deviceID;
+		header.driverVersion = _properties.driverVersion;
+		std::memcpy(header.pipelineCacheUUID, _properties.pipelineCacheUUID, VK_UUID_SIZE);
+		return header;
+	}
+
+	bool PipelineCache::isValid(const FileHeader& header, const std::vector<char>& data) const
+	{
+		const FileHeader expected = makeHeader();
+		if (header.magic != expected.magic || header.version != expected.version
+		|| header.vendorID != expected.vendorID || header.deviceID != expected.deviceID
+		|| header.driverVersion != expected.driverVersion
+		|| std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE))
+			return false;
+
+		if (header.checksum != checksum(data.data(), data.size()))
+			return false;
+
+		// the driver's own header must agree as well
+		struct {
+			uint32_t headerSize;
+			uint32_t headerVersion;
+			uint32_t vendorID;
+			uint32_t deviceID;
+			uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		} vkHeader;
+
+		if (data.size() < sizeof(vkHeader))
+			return false;
+		std::memcpy(&vkHeader, data.data(), sizeof(vkHeader));
+
+		return vkHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+			&& vkHeader.vendorID == expected.vendorID && vkHeader.deviceID == expected.deviceID
+			&& !std::memcmp(vkHeader.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE);
+	}
+
+	uint64_t PipelineCache::checksum(const char* data, size_t size)
+	{
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= static_cast<uint8_t>(data[i]);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+}
\ No newline at end of file
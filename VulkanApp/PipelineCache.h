@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+
+#include "NonCopyable.h"
+
+namespace core
+{
+	// VkPipelineCache persisted between runs. The file starts with our own header
+	// (device identity, driver version and a checksum of the data) so a cache written
+	// by another GPU or driver is discarded instead of being handed to the driver.
+	class PipelineCache : public util::NonCopyable
+	{
+	public:
+		PipelineCache() = default;
+		~PipelineCache() = default;
+
+		void init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path);
+		void save();
+		void clean();
+
+		VkPipelineCache handle() const { return _pipelineCache; }
+		bool warm() const { return _warm; }
+
+	private:
+		struct FileHeader {
+			uint32_t magic;
+			uint32_t version;
+			uint32_t vendorID;
+			uint32_t deviceID;
+			uint32_t driverVersion;
+			uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+			uint64_t dataSize;
+			uint64_t checksum;
+		};
+
+		static const uint32_t MAGIC = 0x43504b56; // "VKPC"
+		static const uint32_t VERSION = 1;
+
+		VkDevice _device = VK_NULL_HANDLE;
+		VkPipelineCache _pipelineCache = VK_NULL_HANDLE;
+		VkPhysicalDeviceProperties _properties;
+		std::string _path;
+		bool _warm = false;
+
+		FileHeader makeHeader() const;
+		bool isValid(const FileHeader& header, const std::vector<char>& data) const;
+
+		static uint64_t checksum(const char* data, size_t size);
+	};
+}
\ No newline at end of file
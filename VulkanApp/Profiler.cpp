@@ -0,0 +1,102 @@
+#include "Profiler.h"
+
+#include <fstream>
+
+namespace util
+{
+	namespace
+	{
+		thread_local void* currentThreadBuffer = nullptr;
+	}
+
+	Profiler::~Profiler()
+	{
+		for (auto* thread : _threads) {
+			Chunk* chunk = thread->head;
+			while (chunk) {
+				Chunk* next = chunk->next.load(std::memory_order_relaxed);
+				delete chunk;
+				chunk = next;
+			}
+			delete thread;
+		}
+	}
+
+	Profiler::ThreadBuffer& Profiler::threadBuffer()
+	{
+		if (!currentThreadBuffer) {
+			auto* thread = new ThreadBuffer();
+			thread->head = thread->tail = new Chunk();
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			thread->id = static_cast<uint32_t>(_threads.size());
+			_threads.push_back(thread);
+			currentThreadBuffer = thread;
+		}
+
+		return *static_cast<ThreadBuffer*>(currentThreadBuffer);
+	}
+
+	void Profiler::record(const char* name, uint64_t begin, uint64_t end)
+	{
+		ThreadBuffer& thread = threadBuffer();
+
+		Chunk* chunk = thread.tail;
+		uint32_t count = chunk->count.load(std::memory_order_relaxed);
+		if (count == CHUNK_SIZE) {
+			Chunk* next = new Chunk();
+			chunk->next.store(next, std::memory_order_release);
+			thread.tail = chunk = next;
+			count = 0;
+		}
+
+		chunk->events[count] = { name, begin, end };
+		// publishes the event to a concurrent export
+		chunk->count.store(count + 1, std::memory_order_release);
+	}
+
+	void Profiler::recordTrack(uint32_t track, const char* name, uint64_t begin, uint64_t end)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_trackEvents.push_back({ track, { name, begin, end } });
+	}
+
+	bool Profiler::exportChromeTrace(const std::string& path)
+	{
+		std::ofstream file(path, std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		const auto writeEvent = [&file](const Event& event, uint32_t pid, uint32_t tid, bool& first) {
+			if (!first)
+				file << ",\n";
+			first = false;
+
+			// timestamps are in microseconds, keep the nanoseconds as decimals
+			file << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << tid
+				<< ",\"ts\":" << event.begin / 1000 << '.' << std::to_string(1000 + event.begin % 1000).substr(1)
+				<< ",\"dur\":" << (event.end - event.begin) / 1000 << '.' << std::to_string(1000 + (event.end - event.begin) % 1000).substr(1)
+				<< '}';
+		};
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		bool first = true;
+		file << "{\"traceEvents\":[\n";
+
+		for (const auto* thread : _threads) {
+			for (const Chunk* chunk = thread->head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+				const uint32_t count = chunk->count.load(std::memory_order_acquire);
+				for (uint32_t i = 0; i < count; ++i)
+					writeEvent(chunk->events[i], 1, thread->id, first);
+			}
+		}
+
+		// tracks go into a second process so they do not mix with the CPU threads
+		for (const auto& trackEvent : _trackEvents)
+			writeEvent(trackEvent.event, 2, trackEvent.track, first);
+
+		file << "\n],\"displayTimeUnit\":\"ns\"}\n";
+		return static_cast<bool>(file);
+	}
+}
\ No newline at end of file
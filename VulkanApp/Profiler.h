@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "NonCopyable.h"
+#include "Singleton.h"
+
+namespace util
+{
+	// Collects timed zones from every thread and exports them as a Chrome trace
+	// (chrome://tracing, Perfetto). Each thread appends to its own chunked buffer without
+	// locking; chunks are never moved, so an export can read them while threads still record.
+	class Profiler : public NonCopyable
+	{
+	public:
+		struct Event {
+			const char* name;
+			uint64_t begin;
+			uint64_t end;
+		};
+
+		Profiler() : _epoch(std::chrono::steady_clock::now()) {}
+		~Profiler();
+
+		// nanoseconds since the profiler was created
+		uint64_t now() const {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _epoch).count();
+		}
+
+		// name must outlive the profiler, string literals are expected
+		void record(const char* name, uint64_t begin, uint64_t end);
+		// events of a timeline that is not a CPU thread, e.g. a GPU queue
+		void recordTrack(uint32_t track, const char* name, uint64_t begin, uint64_t end);
+
+		bool exportChromeTrace(const std::string& path);
+
+	private:
+		static const uint32_t CHUNK_SIZE = 4096;
+
+		struct Chunk {
+			Event events[CHUNK_SIZE];
+			std::atomic<uint32_t> count { 0 };
+			std::atomic<Chunk*> next { nullptr };
+		};
+
+		struct ThreadBuffer {
+			uint32_t id;
+			Chunk* head;
+			Chunk* tail;
+		};
+
+		struct TrackEvent {
+			uint32_t track;
+			Event event;
+		};
+
+		const std::chrono::steady_clock::time_point _epoch;
+
+		std::mutex _mutex;
+		std::vector<ThreadBuffer*> _threads;
+		std::vector<TrackEvent> _trackEvents;
+
+		ThreadBuffer& threadBuffer();
+	};
+
+	class ProfileZone : public NonCopyable
+	{
+	public:
+		explicit ProfileZone(const char* name)
+			: _name(name), _begin(Singleton<Profiler>::instance().now()) {}
+
+		~ProfileZone() {
+			Profiler& profiler = Singleton<Profiler>::instance();
+			profiler.record(_name, _begin, profiler.now());
+		}
+
+	private:
+		const char* _name;
+		const uint64_t _begin;
+	};
+}
+
+#define PROFILE_CONCAT_IMPL(A, B) A ## B
+#define PROFILE_CONCAT(A, B) PROFILE_CONCAT_IMPL(A, B)
+
+// like LOGGING_DISABLE, derived from the build configuration: release builds record no zones and export no trace
+#ifndef _DEBUG
+	#define PROFILING_DISABLE
+#endif
+
+#ifdef PROFILING_DISABLE
+	#define PROFILE_ZONE(NAME)
+	#define PROFILE_EXPORT(PATH) false
+#else
+	#define PROFILE_ZONE(NAME) util::ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(NAME);
+	#define PROFILE_EXPORT(PATH) util::Singleton<util::Profiler>::instance().exportChromeTrace(PATH)
+#endif
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+namespace core
+{
+	namespace
+	{
+		constexpr uint32_t RADIX_BITS = 8;
+		constexpr uint32_t BUCKET_COUNT = 1 << RADIX_BITS;
+
+		uint64_t field(uint32_t value, uint32_t bits)
+		{
+			// NONE and other out of range values sort last
+			return std::min<uint64_t>(value, (1ull << bits) - 1);
+		}
+	}
+
+	uint32_t RenderQueue::addPipeline(VkPipeline pipeline, VkPipelineLayout layout)
+	{
+		_pipelines.push_back({ pipeline, layout });
+		return static_cast<uint32_t>(_pipelines.size() - 1);
+	}
+
+	uint32_t RenderQueue::addMaterial(VkDescriptorSet descriptorSet)
+	{
+		_materials.push_back(descriptorSet);
+		return static_cast<uint32_t>(_materials.size() - 1);
+	}
+
+	uint32_t RenderQueue::addGeometry(const Mesh* mesh, VkBuffer instanceBuffer)
+	{
+		_geometries.push_back({ mesh, instanceBuffer });
+		return static_cast<uint32_t>(_geometries.size() - 1);
+	}
+
+	void RenderQueue::clean()
+	{
+		clear();
+		_pipelines.clear();
+		_materials.clear();
+		_geometries.clear();
+	}
+
+	uint64_t RenderQueue::makeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t geometry, float depth)
+	{
+		const uint64_t depthBits = static_cast<uint64_t>(std::min(std::max(depth, 0.f), 1.f) * ((1 << DEPTH_BITS) - 1));
+		uint64_t key = field(pass, PASS_BITS);
+		key = key << PIPELINE_BITS | field(pipeline, PIPELINE_BITS);
+		key = key << MATERIAL_BITS | field(material, MATERIAL_BITS);
+		key = key << GEOMETRY_BITS | field(geometry, GEOMETRY_BITS);
+		return key << DEPTH_BITS | depthBits;
+	}
+
+	void RenderQueue::push(uint32_t pass, float depth, const DrawCommand& command)
+	{
+		_items.push_back({ makeKey(pass, command.pipeline, command.material, command.geometry, depth),
+			static_cast<uint32_t>(_commands.size()) });
+		_commands.push_back(command);
+	}
+
+	void RenderQueue::clear()
+	{
+		_commands.clear();
+		_items.clear();
+		_draws = 0;
+		_pipelineBinds = 0;
+		_materialBinds = 0;
+		_geometryBinds = 0;
+		_skippedBinds = 0;
+	}
+
+	void RenderQueue::reserve(size_t drawCount)
+	{
+		_commands.reserve(drawCount);
+		_items.reserve(drawCount);
+		_sortBuffer.reserve(drawCount);
+	}
+
+	void RenderQueue::sort(util::JobSystem* jobSystem)
+	{
+		const size_t count = _items.size();
+		if (count < 2)
+			return;
+
+		// digits where every key is the same would not move anything
+		uint64_t varying = 0;
+		for (const Item& item : _items)
+			varying |= item.key ^ _items.front().key;
+
+		// every block counts its digits, then scatters them where the prefix sums over all blocks say:
+		// blocks in order and each block in order keep the sort stable
+		const size_t blockCount = (count + GRAIN - 1) / GRAIN;
+		std::vector<size_t> offsets(blockCount * BUCKET_COUNT);
+		_sortBuffer.resize(count);
+
+		for (uint32_t shift = 0; shift < 64; shift += RADIX_BITS) {
+			if (!((varying >> shift) & (BUCKET_COUNT - 1)))
+				continue;
+
+			const auto forBlocks = [&](const std::function<void(size_t, size_t, size_t)>& function) {
+				const auto blocks = [&](size_t begin, size_t end) {
+					for (size_t block = begin / GRAIN; block * GRAIN < end; ++block)
+						function(block, block * GRAIN, std::min(block * GRAIN + GRAIN, count));
+				};
+				if (jobSystem)
+					jobSystem->parallelFor(count, GRAIN, blocks);
+				else
+					blocks(0, count);
+			};
+
+			forBlocks([&](size_t block, size_t begin, size_t end) {
+				size_t* histogram = offsets.data() + block * BUCKET_COUNT;
+				std::fill(histogram, histogram + BUCKET_COUNT, 0);
+				for (size_t i = begin; i < end; ++i)
+					++histogram[(_items[i].key >> shift) & (BUCKET_COUNT - 1)];
+			});
+
+			size_t sum = 0;
+			for (uint32_t bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+				for (size_t block = 0; block < blockCount; ++block) {
+					const size_t bucketCount = offsets[block * BUCKET_COUNT + bucket];
+					offsets[block * BUCKET_COUNT + bucket] = sum;
+					sum += bucketCount;
+				}
+
+			forBlocks([&](size_t block, size_t begin, size_t end) {
+				size_t* offset = offsets.data() + block * BUCKET_COUNT;
+				for (size_t i = begin; i < end; ++i)
+					_sortBuffer[offset[(_items[i].key >> shift) & (BUCKET_COUNT - 1)]++] = _items[i];
+			});
+
+			_items.swap(_sortBuffer);
+		}
+	}
+
+	RenderQueue::Stats RenderQueue::record(VkCommandBuffer commandBuffer, size_t first, size_t count)
+	{
+		Stats stats;
+		uint32_t pipeline = NONE;
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		uint32_t material = NONE;
+		uint32_t geometry = NONE;
+
+		for (size_t i = first; i < first + count; ++i) {
+			const DrawCommand& command = _commands[_items[i].command];
+
+			if (command.pipeline != pipeline) {
+				pipeline = command.pipeline;
+				if (commandBuffer != VK_NULL_HANDLE)
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelines[pipeline].pipeline);
+				++stats.pipelineBinds;
+
+				// sets stay bound across pipelines of the same layout only
+				if (_pipelines[pipeline].layout != layout) {
+					layout = _pipelines[pipeline].layout;
+					material = NONE;
+				}
+			}
+			else
+				++stats.skippedBinds;
+
+			if (command.material != NONE) {
+				if (command.material != material) {
+					material = command.material;
+					if (commandBuffer != VK_NULL_HANDLE)
+						vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &_materials[material], 0, nullptr);
+					++stats.materialBinds;
+				}
+				else
+					++stats.skippedBinds;
+			}
+
+			if (command.geometry != geometry) {
+				geometry = command.geometry;
+				const Geometry& bound = _geometries[geometry];
+				if (commandBuffer != VK_NULL_HANDLE) {
+					bound.mesh->bind(commandBuffer);
+					if (bound.instanceBuffer != VK_NULL_HANDLE) {
+						const VkDeviceSize offset = 0;
+						vkCmdBindVertexBuffers(commandBuffer, bound.mesh->streamCount(), 1, &bound.instanceBuffer, &offset);
+					}
+				}
+				++stats.geometryBinds;
+			}
+			else
+				++stats.skippedBinds;
+
+			if (commandBuffer != VK_NULL_HANDLE)
+				vkCmdDrawIndexed(commandBuffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset,
+					command.firstInstance);
+			++stats.draws;
+		}
+
+		_draws.fetch_add(stats.draws, std::memory_order_relaxed);
+		_pipelineBinds.fetch_add(stats.pipelineBinds, std::memory_order_relaxed);
+		_materialBinds.fetch_add(stats.materialBinds, std::memory_order_relaxed);
+		_geometryBinds.fetch_add(stats.geometryBinds, std::memory_order_relaxed);
+		_skippedBinds.fetch_add(stats.skippedBinds, std::memory_order_relaxed);
+		return stats;
+	}
+
+	RenderQueue::Stats RenderQueue::stats() const
+	{
+		Stats stats;
+		stats.draws = _draws.load(std::memory_order_relaxed);
+		stats.pipelineBinds = _pipelineBinds.load(std::memory_order_relaxed);
+		stats.materialBinds = _materialBinds.load(std::memory_order_relaxed);
+		stats.geometryBinds = _geometryBinds.load(std::memory_order_relaxed);
+		stats.skippedBinds = _skippedBinds.load(std::memory_order_relaxed);
+		return stats;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "NonCopyable.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+
+namespace core
+{
+	// Draws of a frame sorted by 64-bit keys so that draws sharing state are recorded together,
+	// and recorded without the binds that would not change anything. From the most significant
+	// bits down a key holds the pass, pipeline, material, geometry and a 24-bit depth, so a pass
+	// is recorded pipeline by pipeline, then material by material, front to back within a state.
+	// States are registered once and referred to by index; draws are pushed every frame, sorted
+	// with a parallel LSD radix sort and recorded in ranges, e.g. by CommandRecorder.
+	class RenderQueue : public util::NonCopyable
+	{
+	public:
+		static constexpr uint32_t NONE = ~0u;
+		static constexpr uint32_t PASS_BITS = 4;
+		static constexpr uint32_t PIPELINE_BITS = 10;
+		static constexpr uint32_t MATERIAL_BITS = 14;
+		static constexpr uint32_t GEOMETRY_BITS = 12;
+		static constexpr uint32_t DEPTH_BITS = 24;
+		// items per job of the radix sort
+		static constexpr size_t GRAIN = 16384;
+
+		struct DrawCommand {
+			uint32_t pipeline;
+			uint32_t material;		// NONE binds no descriptor set
+			uint32_t geometry;
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			int32_t vertexOffset;
+			uint32_t firstInstance;
+			uint32_t instanceCount;
+		};
+
+		struct Stats {
+			uint64_t draws = 0;
+			uint64_t pipelineBinds = 0;
+			uint64_t materialBinds = 0;
+			uint64_t geometryBinds = 0;
+			uint64_t skippedBinds = 0;	// binds of a state that was already bound
+		};
+
+		RenderQueue() = default;
+		~RenderQueue() = default;
+
+		uint32_t addPipeline(VkPipeline pipeline, VkPipelineLayout layout);
+		// a descriptor set bound as set 0 of the pipeline's layout
+		uint32_t addMaterial(VkDescriptorSet descriptorSet);
+		// the mesh's streams and indices, and an optional instance-rate buffer bound after the streams
+		uint32_t addGeometry(const Mesh* mesh, VkBuffer instanceBuffer = VK_NULL_HANDLE);
+		void clean();
+
+		// depth from 0 (near) to 1 (far); the queue builds the key from the command's states
+		void push(uint32_t pass, float depth, const DrawCommand& command);
+		// drops the draws and the frame's counters, keeps the registered states
+		void clear();
+		void reserve(size_t drawCount);
+		size_t size() const { return _items.size(); }
+
+		void sort(util::JobSystem* jobSystem = nullptr);
+
+		// Records the draws [first, first + count) of the sorted queue into a command buffer with no
+		// state bound yet, may run on several threads for different ranges. A null command buffer only
+		// counts, to measure the binds of an order
+		Stats record(VkCommandBuffer commandBuffer, size_t first, size_t count);
+		// counters of the ranges recorded since clear()
+		Stats stats() const;
+
+		static uint64_t makeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t geometry, float depth);
+		uint64_t key(size_t index) const { return _items[index].key; }
+		uint32_t command(size_t index) const { return _items[index].command; }
+
+	private:
+		struct Pipeline {
+			VkPipeline pipeline;
+			VkPipelineLayout layout;
+		};
+
+		struct Geometry {
+			const Mesh* mesh;
+			VkBuffer instanceBuffer;
+		};
+
+		struct Item {
+			uint64_t key;
+			uint32_t command;
+		};
+
+		std::vector<Pipeline> _pipelines;
+		std::vector<VkDescriptorSet> _materials;
+		std::vector<Geometry> _geometries;
+
+		std::vector<DrawCommand> _commands;
+		std::vector<Item> _items;
+		std::vector<Item> _sortBuffer;
+
+		std::atomic<uint64_t> _draws { 0 };
+		std::atomic<uint64_t> _pipelineBinds { 0 };
+		std::atomic<uint64_t> _materialBinds { 0 };
+		std::atomic<uint64_t> _geometryBinds { 0 };
+		std::atomic<uint64_t> _skippedBinds { 0 };
+	};
+}
\ No newline at end of file
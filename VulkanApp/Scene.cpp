@@ -0,0 +1,180 @@
+#include "Scene.h"
+
+#include <mutex>
+#include <cstring>
+#include <string>
+
+#ifndef _DEBUG
+	#define LOGGING_DISABLE
+#endif
+#include "Logging.h"
+
+namespace core
+{
+	namespace
+	{
+		struct ComponentRegistry {
+			std::mutex mutex;
+			std::vector<std::pair<size_t, size_t>> components;	// size and alignment by id
+		};
+
+		ComponentRegistry& registry()
+		{
+			static ComponentRegistry registry;
+			return registry;
+		}
+
+		size_t alignUp(size_t value, size_t alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	uint32_t Scene::registerComponent(size_t size, size_t alignment)
+	{
+		ComponentRegistry& components = registry();
+		std::lock_guard<std::mutex> lock(components.mutex);
+		if (components.components.size() == MAX_COMPONENTS)
+			THROW("more than " + std::to_string(MAX_COMPONENTS) + " component types")
+
+		components.components.emplace_back(size, alignment);
+		return static_cast<uint32_t>(components.components.size() - 1);
+	}
+
+	Scene::ComponentInfo Scene::componentInfo(uint32_t id)
+	{
+		ComponentRegistry& components = registry();
+		std::lock_guard<std::mutex> lock(components.mutex);
+		return { components.components[id].first, components.components[id].second };
+	}
+
+	uint32_t Scene::archetype(ComponentMask mask)
+	{
+		const auto found = _archetypeIndices.find(mask);
+		if (found != _archetypeIndices.end())
+			return found->second;
+
+		auto archetype = std::make_unique<Archetype>();
+		archetype->mask = mask;
+		archetype->count = 0;
+		size_t rowSize = sizeof(Entity);
+		for (uint32_t id = 0; id < MAX_COMPONENTS; ++id)
+			if (mask & (ComponentMask(1) << id)) {
+				archetype->components.push_back(id);
+				archetype->sizes[id] = static_cast<uint32_t>(componentInfo(id).size);
+				rowSize += archetype->sizes[id];
+			}
+
+		// the largest row count whose columns, each aligned, fit in a chunk
+		const auto layout = [&archetype](size_t capacity) {
+			size_t offset = alignUp(sizeof(Entity) * capacity, COLUMN_ALIGNMENT);
+			for (uint32_t id : archetype->components) {
+				archetype->offsets[id] = static_cast<uint32_t>(offset);
+				offset = alignUp(offset + archetype->sizes[id] * capacity, COLUMN_ALIGNMENT);
+			}
+			return offset;
+		};
+		archetype->capacity = CHUNK_SIZE / rowSize;
+		while (archetype->capacity > 1 && layout(archetype->capacity) > CHUNK_SIZE)
+			--archetype->capacity;
+		if (layout(archetype->capacity) > CHUNK_SIZE)
+			THROW("components of " + std::to_string(rowSize) + " bytes do not fit in a chunk")
+
+		_archetypes.push_back(std::move(archetype));
+		_archetypeIndices[mask] = static_cast<uint32_t>(_archetypes.size() - 1);
+		return static_cast<uint32_t>(_archetypes.size() - 1);
+	}
+
+	Entity Scene::allocateEntity(uint32_t archetypeIndex)
+	{
+		Entity entity;
+		if (!_freeIndices.empty()) {
+			entity.index = _freeIndices.back();
+			_freeIndices.pop_back();
+		}
+		else {
+			entity.index = static_cast<uint32_t>(_records.size());
+			_records.push_back({ 0, 0, 0 });
+		}
+
+		Record& record = _records[entity.index];
+		entity.generation = record.generation;
+		record.archetype = archetypeIndex;
+		record.row = pushRow(*_archetypes[archetypeIndex], entity);
+		return entity;
+	}
+
+	uint32_t Scene::pushRow(Archetype& archetype, Entity entity)
+	{
+		const size_t row = archetype.count++;
+		if (row / archetype.capacity == archetype.chunks.size())
+			archetype.chunks.push_back(std::make_unique<Chunk>());
+
+		Chunk& chunk = *archetype.chunks[row / archetype.capacity];
+		reinterpret_cast<Entity*>(chunk.data)[row % archetype.capacity] = entity;
+		return static_cast<uint32_t>(row);
+	}
+
+	void Scene::eraseRow(Archetype& archetype, uint32_t row)
+	{
+		const uint32_t last = static_cast<uint32_t>(--archetype.count);
+		if (row == last)
+			return;
+
+		Entity* entities = reinterpret_cast<Entity*>(archetype.chunks[row / archetype.capacity]->data);
+		const Entity moved = reinterpret_cast<Entity*>(archetype.chunks[last / archetype.capacity]->data)[last % archetype.capacity];
+		entities[row % archetype.capacity] = moved;
+		for (uint32_t id : archetype.components)
+			std::memcpy(element(archetype, id, row), element(archetype, id, last), archetype.sizes[id]);
+		_records[moved.index].row = row;
+	}
+
+	void Scene::move(Entity entity, uint32_t target)
+	{
+		Record& record = _records[entity.index];
+		Archetype& source = *_archetypes[record.archetype];
+		Archetype& destination = *_archetypes[target];
+
+		const uint32_t row = pushRow(destination, entity);
+		for (uint32_t id : destination.components)
+			if (source.mask & (ComponentMask(1) << id))
+				std::memcpy(element(destination, id, row), element(source, id, record.row), destination.sizes[id]);
+
+		eraseRow(source, record.row);
+		record.archetype = target;
+		record.row = row;
+	}
+
+	void Scene::destroy(Entity entity)
+	{
+		if (!alive(entity))
+			return;
+
+		Record& record = _records[entity.index];
+		eraseRow(*_archetypes[record.archetype], record.row);
+		++record.generation;
+		_freeIndices.push_back(entity.index);
+	}
+
+	void Scene::clear()
+	{
+		_archetypes.clear();
+		_archetypeIndices.clear();
+		_records.clear();
+		_freeIndices.clear();
+	}
+
+	bool Scene::alive(Entity entity) const
+	{
+		// destroying bumps the generation, a free record's generation is not in any handle given out yet
+		return entity.index < _records.size() && _records[entity.index].generation == entity.generation;
+	}
+
+	size_t Scene::chunkCount() const
+	{
+		size_t count = 0;
+		for (const auto& archetype : _archetypes)
+			count += archetype->chunks.size();
+		return count;
+	}
+}
\ No newline at end of file
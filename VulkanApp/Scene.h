@@ -0,0 +1,269 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#include "NonCopyable.h"
+#include "JobSystem.h"
+
+namespace core
+{
+	// index into the scene's entity records, the generation tells a reused index from a stale handle
+	struct Entity {
+		uint32_t index;
+		uint32_t generation;
+
+		bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(const Entity& other) const { return !(*this == other); }
+	};
+
+	// Entity-component storage. Entities with the same set of components share an archetype, which
+	// stores them in 16 KB chunks as structure of arrays: one array of entities, then one 64-byte
+	// aligned array per component. Destroying an entity moves the archetype's last one into its row,
+	// so chunks stay packed and queries run over plain arrays. Components are trivially copyable
+	// values, up to MAX_COMPONENTS types; queries name them as template arguments, a const type
+	// marks read-only access. Structural changes (create, destroy, add, remove) are single threaded,
+	// queries may run on the job system as long as none happens meanwhile.
+	class Scene : public util::NonCopyable
+	{
+	public:
+		static constexpr size_t CHUNK_SIZE = 16 * 1024;
+		static constexpr uint32_t MAX_COMPONENTS = 64;
+		static constexpr size_t COLUMN_ALIGNMENT = 64;
+		// chunks per job of parallelForEachChunk
+		static constexpr size_t CHUNK_GRAIN = 4;
+
+		typedef uint64_t ComponentMask;
+
+		Scene() = default;
+		~Scene() = default;
+
+		template<typename... Components>
+		Entity create(const Components&... components);
+		void destroy(Entity entity);
+		void clear();
+
+		bool alive(Entity entity) const;
+		size_t size() const { return _records.size() - _freeIndices.size(); }
+
+		// null when the entity does not have the component
+		template<typename Component>
+		Component* get(Entity entity);
+		template<typename Component>
+		void add(Entity entity, const Component& component);
+		template<typename Component>
+		void remove(Entity entity);
+
+		// function(const Entity* entities, size_t count, Components*... columns) per chunk holding
+		// at least the components
+		template<typename... Components, typename Function>
+		void forEachChunk(const Function& function);
+		template<typename... Components, typename Function>
+		void parallelForEachChunk(util::JobSystem& jobSystem, const Function& function);
+		// function(Entity entity, Components&... components) per entity
+		template<typename... Components, typename Function>
+		void each(const Function& function);
+
+		template<typename... Components>
+		size_t count();
+
+		template<typename Component>
+		static uint32_t componentId();
+		template<typename... Components>
+		static ComponentMask componentMask();
+
+		size_t archetypeCount() const { return _archetypes.size(); }
+		size_t chunkCount() const;
+
+	private:
+		struct Chunk {
+			alignas(COLUMN_ALIGNMENT) unsigned char data[CHUNK_SIZE];
+		};
+
+		struct Archetype {
+			ComponentMask mask;
+			std::vector<uint32_t> components;	// ids in increasing order
+			uint32_t offsets[MAX_COMPONENTS];	// column offsets by component id, for the ids of the mask
+			uint32_t sizes[MAX_COMPONENTS];
+			size_t capacity;					// entities per chunk
+			size_t count;						// entities, the chunks before the last one are full
+			std::vector<std::unique_ptr<Chunk>> chunks;	// kept when emptied, for the next entities
+		};
+
+		struct Record {
+			uint32_t archetype;
+			uint32_t row;			// in the archetype, chunk row / capacity
+			uint32_t generation;
+		};
+
+		struct ComponentInfo {
+			size_t size;
+			size_t alignment;
+		};
+
+		std::vector<std::unique_ptr<Archetype>> _archetypes;
+		std::unordered_map<ComponentMask, uint32_t> _archetypeIndices;
+		std::vector<Record> _records;
+		std::vector<uint32_t> _freeIndices;
+
+		static uint32_t registerComponent(size_t size, size_t alignment);
+		static ComponentInfo componentInfo(uint32_t id);
+
+		uint32_t archetype(ComponentMask mask);
+		Entity allocateEntity(uint32_t archetype);
+		// appends a row for entity, returns it
+		uint32_t pushRow(Archetype& archetype, Entity entity);
+		// fills the row with the archetype's last one, fixing the moved entity's record
+		void eraseRow(Archetype& archetype, uint32_t row);
+		// moves the entity's components present in both archetypes, the others of the target are uninitialized
+		void move(Entity entity, uint32_t target);
+
+		unsigned char* element(Archetype& archetype, uint32_t componentId, uint32_t row)
+		{
+			Chunk& chunk = *archetype.chunks[row / archetype.capacity];
+			return chunk.data + archetype.offsets[componentId] + archetype.sizes[componentId] * (row % archetype.capacity);
+		}
+
+		template<typename Component>
+		static Component* column(Archetype& archetype, Chunk& chunk)
+		{
+			return reinterpret_cast<Component*>(chunk.data + archetype.offsets[componentId<typename std::remove_const<Component>::type>()]);
+		}
+	};
+
+	template<typename Component>
+	uint32_t Scene::componentId()
+	{
+		static_assert(std::is_trivially_copyable<Component>::value, "components are moved around with memcpy");
+		static_assert(alignof(Component) <= COLUMN_ALIGNMENT, "component alignment exceeds the column alignment");
+		static const uint32_t id = registerComponent(sizeof(Component), alignof(Component));
+		return id;
+	}
+
+	template<typename... Components>
+	Scene::ComponentMask Scene::componentMask()
+	{
+		ComponentMask mask = 0;
+		const uint32_t ids[] = { 0u, componentId<typename std::remove_const<Components>::type>()... };
+		for (size_t i = 1; i < sizeof(ids) / sizeof(ids[0]); ++i)
+			mask |= ComponentMask(1) << ids[i];
+		return mask;
+	}
+
+	template<typename... Components>
+	Entity Scene::create(const Components&... components)
+	{
+		const uint32_t archetypeIndex = archetype(componentMask<Components...>());
+		const Entity entity = allocateEntity(archetypeIndex);
+
+		Archetype& archetype = *_archetypes[archetypeIndex];
+		const uint32_t row = _records[entity.index].row;
+		const int expand[] = { 0, (*reinterpret_cast<Components*>(element(archetype, componentId<Components>(), row)) = components, 0)... };
+		(void)expand;
+		return entity;
+	}
+
+	template<typename Component>
+	Component* Scene::get(Entity entity)
+	{
+		if (!alive(entity))
+			return nullptr;
+
+		const Record& record = _records[entity.index];
+		Archetype& archetype = *_archetypes[record.archetype];
+		const uint32_t id = componentId<Component>();
+		if (!(archetype.mask & (ComponentMask(1) << id)))
+			return nullptr;
+		return reinterpret_cast<Component*>(element(archetype, id, record.row));
+	}
+
+	template<typename Component>
+	void Scene::add(Entity entity, const Component& component)
+	{
+		if (!alive(entity))
+			return;
+
+		const ComponentMask mask = _archetypes[_records[entity.index].archetype]->mask | componentMask<Component>();
+		if (mask != _archetypes[_records[entity.index].archetype]->mask)
+			move(entity, archetype(mask));
+		*get<Component>(entity) = component;
+	}
+
+	template<typename Component>
+	void Scene::remove(Entity entity)
+	{
+		if (!alive(entity))
+			return;
+
+		const ComponentMask mask = _archetypes[_records[entity.index].archetype]->mask & ~componentMask<Component>();
+		if (mask != _archetypes[_records[entity.index].archetype]->mask)
+			move(entity, archetype(mask));
+	}
+
+	template<typename... Components, typename Function>
+	void Scene::forEachChunk(const Function& function)
+	{
+		const ComponentMask mask = componentMask<Components...>();
+		for (auto& archetype : _archetypes) {
+			if ((archetype->mask & mask) != mask)
+				continue;
+
+			for (size_t first = 0, c = 0; first < archetype->count; first += archetype->capacity, ++c) {
+				Chunk& chunk = *archetype->chunks[c];
+				function(reinterpret_cast<const Entity*>(chunk.data), std::min(archetype->capacity, archetype->count - first),
+					column<Components>(*archetype, chunk)...);
+			}
+		}
+	}
+
+	template<typename... Components, typename Function>
+	void Scene::parallelForEachChunk(util::JobSystem& jobSystem, const Function& function)
+	{
+		struct ChunkRange {
+			Archetype* archetype;
+			size_t chunk;
+		};
+
+		const ComponentMask mask = componentMask<Components...>();
+		std::vector<ChunkRange> chunks;
+		for (auto& archetype : _archetypes)
+			if ((archetype->mask & mask) == mask)
+				for (size_t first = 0, c = 0; first < archetype->count; first += archetype->capacity, ++c)
+					chunks.push_back({ archetype.get(), c });
+
+		jobSystem.parallelFor(chunks.size(), CHUNK_GRAIN, [&chunks, &function](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				Archetype& archetype = *chunks[i].archetype;
+				Chunk& chunk = *archetype.chunks[chunks[i].chunk];
+				const size_t first = chunks[i].chunk * archetype.capacity;
+				function(reinterpret_cast<const Entity*>(chunk.data), std::min(archetype.capacity, archetype.count - first),
+					column<Components>(archetype, chunk)...);
+			}
+		});
+	}
+
+	template<typename... Components, typename Function>
+	void Scene::each(const Function& function)
+	{
+		forEachChunk<Components...>([&function](const Entity* entities, size_t count, Components*... columns) {
+			for (size_t i = 0; i < count; ++i)
+				function(entities[i], columns[i]...);
+		});
+	}
+
+	template<typename... Components>
+	size_t Scene::count()
+	{
+		const ComponentMask mask = componentMask<Components...>();
+		size_t result = 0;
+		for (const auto& archetype : _archetypes)
+			if ((archetype->mask & mask) == mask)
+				result += archetype->count;
+		return result;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace core
+{
+	namespace
+	{
+		uint32_t highestBit(uint64_t value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanReverse64(&index, value);
+			return index;
+#else
+			return 63 - __builtin_clzll(value);
+#endif
+		}
+
+		uint32_t lowestBit(uint64_t value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward64(&index, value);
+			return index;
+#else
+			return __builtin_ctzll(value);
+#endif
+		}
+	}
+
+	TlsfAllocator::TlsfAllocator(uint64_t size) : _size(size)
+	{
+		for (auto& heads : _heads)
+			std::fill(std::begin(heads), std::end(heads), NONE);
+
+		if (_size)
+			insertFree(createBlock(0, _size, NONE, NONE));
+	}
+
+	void TlsfAllocator::mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+	{
+		if (size < SL_COUNT) {
+			fl = 0;
+			sl = static_cast<uint32_t>(size);
+			return;
+		}
+
+		const uint32_t log2 = highestBit(size);
+		fl = log2 - SL_LOG2 + 1;
+		sl = static_cast<uint32_t>(size >> (log2 - SL_LOG2)) ^ SL_COUNT;
+	}
+
+	uint64_t TlsfAllocator::allocate(uint64_t size, uint64_t alignment)
+	{
+		size = std::max<uint64_t>(size, 1);
+		alignment = std::max<uint64_t>(alignment, 1);
+
+		// any range of the size class found is large enough for the request and its worst case padding
+		const uint32_t block = findFree(size + alignment - 1);
+		if (block == NONE)
+			return INVALID_OFFSET;
+
+		removeFree(block);
+
+		const uint64_t offset = _blocks[block].offset;
+		const uint64_t alignedOffset = (offset + alignment - 1) / alignment * alignment;
+
+		uint32_t allocated = block;
+		if (alignedOffset != offset) {
+			// the padding stays free in front, its previous neighbour is used since free ranges are always merged
+			allocated = split(block, alignedOffset - offset);
+			insertFree(block);
+		}
+
+		if (_blocks[allocated].size > size)
+			insertFree(split(allocated, size));
+
+		_blocks[allocated].free = false;
+		_allocations.emplace(alignedOffset, allocated);
+		_used += _blocks[allocated].size;
+
+		return alignedOffset;
+	}
+
+	void TlsfAllocator::free(uint64_t offset)
+	{
+		auto it = _allocations.find(offset);
+		if (it == _allocations.end())
+			return;
+
+		uint32_t block = it->second;
+		_allocations.erase(it);
+		_used -= _blocks[block].size;
+
+		const uint32_t prev = _blocks[block].prevPhysical;
+		if (prev != NONE && _blocks[prev].free) {
+			removeFree(prev);
+			merge(prev, block);
+			block = prev;
+		}
+
+		const uint32_t next = _blocks[block].nextPhysical;
+		if (next != NONE && _blocks[next].free) {
+			removeFree(next);
+			merge(block, next);
+		}
+
+		insertFree(block);
+	}
+
+	TlsfAllocator::Stats TlsfAllocator::stats() const
+	{
+		Stats stats;
+		stats.size = _size;
+		stats.used = _used;
+		stats.allocationCount = _allocations.size();
+
+		for (uint32_t fl = 0; fl < FL_COUNT; ++fl)
+			for (uint32_t sl = 0; sl < SL_COUNT; ++sl)
+				for (uint32_t block = _heads[fl][sl]; block != NONE; block = _blocks[block].nextFree) {
+					++stats.freeRangeCount;
+					stats.largestFreeRange = std::max(stats.largestFreeRange, _blocks[block].size);
+				}
+
+		return stats;
+	}
+
+	uint32_t TlsfAllocator::createBlock(uint64_t offset, uint64_t size, uint32_t prevPhysical, uint32_t nextPhysical)
+	{
+		uint32_t block;
+		if (!_unusedBlocks.empty()) {
+			block = _unusedBlocks.back();
+			_unusedBlocks.pop_back();
+		}
+		else {
+			block = static_cast<uint32_t>(_blocks.size());
+			_blocks.emplace_back();
+		}
+
+		_blocks[block] = { offset, size, prevPhysical, nextPhysical, NONE, NONE, true };
+		return block;
+	}
+
+	void TlsfAllocator::destroyBlock(uint32_t block)
+	{
+		_unusedBlocks.push_back(block);
+	}
+
+	void TlsfAllocator::insertFree(uint32_t block)
+	{
+		uint32_t fl, sl;
+		mapping(_blocks[block].size, fl, sl);
+
+		Block& b = _blocks[block];
+		b.free = true;
+		b.prevFree = NONE;
+		b.nextFree = _heads[fl][sl];
+		if (b.nextFree != NONE)
+			_blocks[b.nextFree].prevFree = block;
+
+		_heads[fl][sl] = block;
+		_flBitmap |= 1ull << fl;
+		_slBitmaps[fl] |= 1u << sl;
+	}
+
+	void TlsfAllocator::removeFree(uint32_t block)
+	{
+		uint32_t fl, sl;
+		mapping(_blocks[block].size, fl, sl);
+
+		Block& b = _blocks[block];
+		if (b.prevFree != NONE)
+			_blocks[b.prevFree].nextFree = b.nextFree;
+		else
+			_heads[fl][sl] = b.nextFree;
+
+		if (b.nextFree != NONE)
+			_blocks[b.nextFree].prevFree = b.prevFree;
+
+		if (_heads[fl][sl] == NONE) {
+			_slBitmaps[fl] &= ~(1u << sl);
+			if (!_slBitmaps[fl])
+				_flBitmap &= ~(1ull << fl);
+		}
+
+		b.free = false;
+	}
+
+	uint32_t TlsfAllocator::findFree(uint64_t size)
+	{
+		// round up to the next size class so every range in it fits
+		if (size >= SL_COUNT) {
+			const uint64_t round = (1ull << (highestBit(size) - SL_LOG2)) - 1;
+			if (size > ~0ull - round)
+				return NONE;
+			size += round;
+		}
+
+		uint32_t fl, sl;
+		mapping(size, fl, sl);
+		if (fl >= FL_COUNT)
+			return NONE;
+
+		uint32_t slMap = _slBitmaps[fl] & (~0u << sl);
+		if (!slMap) {
+			const uint64_t flMap = fl + 1 < FL_COUNT ? _flBitmap & (~0ull << (fl + 1)) : 0;
+			if (!flMap)
+				return NONE;
+
+			fl = lowestBit(flMap);
+			slMap = _slBitmaps[fl];
+		}
+
+		return _heads[fl][lowestBit(slMap)];
+	}
+
+	uint32_t TlsfAllocator::split(uint32_t block, uint64_t size)
+	{
+		// keeps the first size bytes in block, returns the remainder
+		const uint32_t next = _blocks[block].nextPhysical;
+		const uint32_t remainder = createBlock(_blocks[block].offset + size, _blocks[block].size - size, block, next);
+
+		if (next != NONE)
+			_blocks[next].prevPhysical = remainder;
+
+		_blocks[block].size = size;
+		_blocks[block].nextPhysical = remainder;
+		return remainder;
+	}
+
+	void TlsfAllocator::merge(uint32_t block, uint32_t next)
+	{
+		_blocks[block].size += _blocks[next].size;
+		_blocks[block].nextPhysical = _blocks[next].nextPhysical;
+
+		if (_blocks[block].nextPhysical != NONE)
+			_blocks[_blocks[block].nextPhysical].prevPhysical = block;
+
+		destroyBlock(next);
+	}
+}
\ No newline at end of file
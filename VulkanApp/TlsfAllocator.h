@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+namespace core
+{
+	// Two-level segregated fit allocator over the offsets of a range: free ranges are kept in
+	// size classes (power of two, each split into 16 linear steps) indexed by two bitmaps, so
+	// allocate and free are O(1). Neighbouring free ranges are merged on free. It only hands
+	// out offsets and touches no memory, the range can live anywhere (e.g. a VkDeviceMemory).
+	class TlsfAllocator
+	{
+	public:
+		static constexpr uint64_t INVALID_OFFSET = ~0ull;
+
+		struct Stats {
+			uint64_t size = 0;
+			uint64_t used = 0;
+			uint64_t allocationCount = 0;
+			uint64_t freeRangeCount = 0;
+			uint64_t largestFreeRange = 0;
+		};
+
+		explicit TlsfAllocator(uint64_t size);
+
+		uint64_t allocate(uint64_t size, uint64_t alignment = 1);
+		void free(uint64_t offset);
+
+		bool empty() const { return _allocations.empty(); }
+		Stats stats() const;
+
+	private:
+		static constexpr uint32_t SL_LOG2 = 4;
+		static constexpr uint32_t SL_COUNT = 1 << SL_LOG2;
+		static constexpr uint32_t FL_COUNT = 64 - SL_LOG2 + 1;
+		static constexpr uint32_t NONE = ~0u;
+
+		struct Block {
+			uint64_t offset;
+			uint64_t size;
+			uint32_t prevPhysical;
+			uint32_t nextPhysical;
+			uint32_t prevFree;
+			uint32_t nextFree;
+			bool free;
+		};
+
+		uint64_t _size;
+		uint64_t _used = 0;
+
+		std::vector<Block> _blocks;
+		std::vector<uint32_t> _unusedBlocks;
+		std::unordered_map<uint64_t, uint32_t> _allocations;
+
+		uint64_t _flBitmap = 0;
+		uint32_t _slBitmaps[FL_COUNT] = {};
+		uint32_t _heads[FL_COUNT][SL_COUNT];
+
+		static void mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+
+		uint32_t createBlock(uint64_t offset, uint64_t size, uint32_t prevPhysical, uint32_t nextPhysical);
+		void destroyBlock(uint32_t block);
+		void insertFree(uint32_t block);
+		void removeFree(uint32_t block);
+		uint32_t findFree(uint64_t size);
+		uint32_t split(uint32_t block, uint64_t size);
+		void merge(uint32_t block, uint32_t next);
+	};
+}
\ No newline at end of file
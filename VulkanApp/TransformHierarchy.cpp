@@ -0,0 +1,186 @@
+#include "TransformHierarchy.h"
+
+#include <glm/simd/platform.h>
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	#include <glm/simd/matrix.h>
+#endif
+#if defined(__AVX__)
+	#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+namespace core
+{
+	namespace
+	{
+		// out = parent * local, the three may not overlap
+		inline void multiply(const glm::mat4& parent, const glm::mat4& local, glm::mat4& out)
+		{
+#if defined(__AVX__)
+			// two output columns per instruction: the parent's columns are broadcast to both lanes,
+			// each lane picks the components of its own local column
+			const float* a = &parent[0][0];
+			const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+			const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+			const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+			const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+			for (int column = 0; column < 4; column += 2) {
+				const __m256 b = _mm256_loadu_ps(&local[column][0]);
+				const __m256 m0 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+				const __m256 m1 = _mm256_mul_ps(a1, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1)));
+				const __m256 m2 = _mm256_mul_ps(a2, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2)));
+				const __m256 m3 = _mm256_mul_ps(a3, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3)));
+				_mm256_storeu_ps(&out[column][0], _mm256_add_ps(_mm256_add_ps(m0, m1), _mm256_add_ps(m2, m3)));
+			}
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+			const glm_vec4 a[4] = { _mm_load_ps(&parent[0][0]), _mm_load_ps(&parent[1][0]), _mm_load_ps(&parent[2][0]), _mm_load_ps(&parent[3][0]) };
+			const glm_vec4 b[4] = { _mm_load_ps(&local[0][0]), _mm_load_ps(&local[1][0]), _mm_load_ps(&local[2][0]), _mm_load_ps(&local[3][0]) };
+			glm_vec4 result[4];
+			glm_mat4_mul(a, b, result);
+			for (int column = 0; column < 4; ++column)
+				_mm_store_ps(&out[column][0], result[column]);
+#else
+			out = parent * local;
+#endif
+		}
+	}
+
+	uint32_t TransformHierarchy::add(uint32_t parent, const glm::mat4& local)
+	{
+		const uint32_t node = static_cast<uint32_t>(_slots.size());
+		const uint32_t slot = static_cast<uint32_t>(_nodes.size());
+		const uint32_t parentSlot = parent == NONE ? NONE : _slots[parent];
+		const uint32_t depth = parent == NONE ? 0 : _depths[parentSlot] + 1;
+
+		// appending keeps the order as long as depths do not decrease
+		if (!_depths.empty() && depth < _depths.back())
+			_sorted = false;
+		else if (depth == _levelEnds.size())
+			_levelEnds.push_back(slot + 1);
+		else
+			_levelEnds.back() = slot + 1;
+
+		_slots.push_back(slot);
+		_nodes.push_back(node);
+		_locals.push_back({ local });
+		_worlds.push_back({ glm::mat4(1.f) });
+		_parentSlots.push_back(parentSlot);
+		_depths.push_back(depth);
+		_dirty.push_back(1);
+		++_dirtyCount;
+		return node;
+	}
+
+	void TransformHierarchy::clear()
+	{
+		_locals.clear();
+		_worlds.clear();
+		_parentSlots.clear();
+		_depths.clear();
+		_nodes.clear();
+		_dirty.clear();
+		_slots.clear();
+		_levelEnds.clear();
+		_sorted = true;
+		_dirtyCount = 0;
+		_updatedCount = 0;
+	}
+
+	void TransformHierarchy::setLocal(uint32_t node, const glm::mat4& local)
+	{
+		const uint32_t slot = _slots[node];
+		_locals[slot].value = local;
+		_dirtyCount += !_dirty[slot];
+		_dirty[slot] = 1;
+	}
+
+	void TransformHierarchy::sort()
+	{
+		// counting sort by depth, stable so siblings keep their order
+		const uint32_t levelCount = *std::max_element(_depths.begin(), _depths.end()) + 1;
+		_levelEnds.assign(levelCount, 0);
+		for (uint32_t depth : _depths)
+			++_levelEnds[depth];
+		size_t end = 0;
+		std::vector<size_t> next(levelCount);
+		for (uint32_t depth = 0; depth < levelCount; ++depth) {
+			next[depth] = end;
+			end += _levelEnds[depth];
+			_levelEnds[depth] = end;
+		}
+
+		std::vector<uint32_t> newSlots(_nodes.size());
+		for (size_t slot = 0; slot < _nodes.size(); ++slot)
+			newSlots[slot] = static_cast<uint32_t>(next[_depths[slot]]++);
+
+		const auto permute = [&newSlots](auto& values) {
+			typename std::remove_reference<decltype(values)>::type sorted(values.size());
+			for (size_t slot = 0; slot < values.size(); ++slot)
+				sorted[newSlots[slot]] = values[slot];
+			values.swap(sorted);
+		};
+		permute(_locals);
+		permute(_worlds);
+		permute(_parentSlots);
+		permute(_depths);
+		permute(_nodes);
+		permute(_dirty);
+
+		for (auto& parentSlot : _parentSlots)
+			if (parentSlot != NONE)
+				parentSlot = newSlots[parentSlot];
+		for (size_t slot = 0; slot < _nodes.size(); ++slot)
+			_slots[_nodes[slot]] = static_cast<uint32_t>(slot);
+		_sorted = true;
+	}
+
+	size_t TransformHierarchy::updateRange(size_t begin, size_t end)
+	{
+		size_t updated = 0;
+		for (size_t slot = begin; slot < end; ++slot) {
+			const uint32_t parent = _parentSlots[slot];
+			// parents are a level up, already final for this update
+			const bool dirty = _dirty[slot] || (parent != NONE && _dirty[parent]);
+			if (!dirty)
+				continue;
+
+			_dirty[slot] = 1;
+			if (parent == NONE)
+				_worlds[slot].value = _locals[slot].value;
+			else
+				multiply(_worlds[parent].value, _locals[slot].value, _worlds[slot].value);
+			++updated;
+		}
+		return updated;
+	}
+
+	void TransformHierarchy::update(util::JobSystem* jobSystem)
+	{
+		_updatedCount = 0;
+		if (!_dirtyCount)
+			return;
+		if (!_sorted)
+			sort();
+
+		size_t begin = 0;
+		for (size_t end : _levelEnds) {
+			if (jobSystem && end - begin > GRAIN) {
+				std::atomic<size_t> updated { 0 };
+				jobSystem->parallelFor(end - begin, GRAIN, [this, begin, &updated](size_t first, size_t last) {
+					updated.fetch_add(updateRange(begin + first, begin + last), std::memory_order_relaxed);
+				});
+				_updatedCount += updated.load(std::memory_order_relaxed);
+			}
+			else
+				_updatedCount += updateRange(begin, end);
+			begin = end;
+		}
+
+		std::memset(_dirty.data(), 0, _dirty.size());
+		_dirtyCount = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "NonCopyable.h"
+#include "JobSystem.h"
+
+namespace core
+{
+	// Local to world transforms of a node hierarchy. Nodes live in flat arrays sorted by depth, so
+	// one pass over the arrays sees every parent before its children and a depth level is one
+	// contiguous range that the job system can split. Changing a local transform flags its node;
+	// update() carries the flag down to the children and only recomputes flagged nodes, static
+	// subtrees cost a flag test each. Matrix products run on SSE2 (glm/simd/matrix.h) or AVX.
+	class TransformHierarchy : public util::NonCopyable
+	{
+	public:
+		static constexpr uint32_t NONE = ~0u;
+		// nodes per job within a depth level
+		static constexpr size_t GRAIN = 4096;
+
+		TransformHierarchy() = default;
+		~TransformHierarchy() = default;
+
+		// parent is NONE for a root, nodes are identified by the order they were added in
+		uint32_t add(uint32_t parent, const glm::mat4& local);
+		void clear();
+
+		void setLocal(uint32_t node, const glm::mat4& local);
+		const glm::mat4& local(uint32_t node) const { return _locals[_slots[node]].value; }
+		// as of the last update
+		const glm::mat4& world(uint32_t node) const { return _worlds[_slots[node]].value; }
+
+		// recomputes the world transforms of the flagged nodes and their descendants, level by
+		// level, splitting levels over the job system when one is given
+		void update(util::JobSystem* jobSystem = nullptr);
+
+		size_t size() const { return _slots.size(); }
+		size_t levelCount() const { return _levelEnds.size(); }
+		// world transforms the last update recomputed
+		size_t updatedCount() const { return _updatedCount; }
+
+	private:
+		// aligned for the SIMD loads
+		struct alignas(16) Matrix {
+			glm::mat4 value;
+		};
+
+		// by slot: depth order
+		std::vector<Matrix> _locals;
+		std::vector<Matrix> _worlds;
+		std::vector<uint32_t> _parentSlots;
+		std::vector<uint32_t> _depths;
+		std::vector<uint32_t> _nodes;		// node of each slot
+		std::vector<uint8_t> _dirty;
+
+		std::vector<uint32_t> _slots;		// slot of each node
+		std::vector<size_t> _levelEnds;		// one past the last slot of each depth
+		bool _sorted = true;
+		size_t _dirtyCount = 0;
+		size_t _updatedCount = 0;
+
+		void sort();
+		// returns the number of world transforms recomputed in [begin, end) of one level
+		size_t updateRange(size_t begin, size_t end);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,286 @@
+#include "UploadManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#ifndef _DEBUG
+	#define LOGGING_DISABLE
+#endif
+
+#include "Logging.h"
+
+namespace core
+{
+	void UploadManager::init(VkDevice device, MemoryAllocator& allocator, uint32_t slotCount,
+		uint32_t queueFamily, uint32_t ownerFamily, VkDeviceSize ringSize)
+	{
+		_device = device;
+		_allocator = &allocator;
+		_queueFamily = queueFamily;
+		_ownerFamily = ownerFamily;
+		_size = ringSize;
+		_frameHeads.assign(slotCount, 0);
+
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = _size;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkResult result = vkCreateBuffer(_device, &bufferInfo, nullptr, &_buffer);
+		if (result != VK_SUCCESS)
+			THROW("failed to create upload ring buffer with error: " + std::to_string(result))
+
+		// coherent memory needs no flush, uncached write-combined memory is the fastest to stream into
+		_memory = _allocator->bind(_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	}
+
+	void UploadManager::clean()
+	{
+		if (_device == VK_NULL_HANDLE)
+			return;
+
+		vkDestroyBuffer(_device, _buffer, nullptr);
+		_allocator->free(_memory);
+		_device = VK_NULL_HANDLE;
+	}
+
+	bool UploadManager::reserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+	{
+		uint64_t position = _head;
+		VkDeviceSize ringOffset = position % _size;
+
+		const VkDeviceSize aligned = (ringOffset + alignment - 1) / alignment * alignment;
+		position += aligned - ringOffset;
+		ringOffset = aligned;
+
+		// a region never wraps, it starts over at the beginning of the ring instead
+		if (ringOffset + size > _size) {
+			position += _size - ringOffset;
+			ringOffset = 0;
+		}
+
+		if (size > _size || position + size - _tail > _size) {
+			++_stats.rejected;
+			return false;
+		}
+
+		_head = position + size;
+		_stats.peakUsage = std::max<VkDeviceSize>(_stats.peakUsage, _head - _tail);
+		offset = ringOffset;
+		return true;
+	}
+
+	bool UploadManager::upload(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		VkDeviceSize ringOffset;
+		if (!reserve(size, 16, ringOffset))
+			return false;
+
+		std::memcpy(static_cast<char*>(_memory.mapped) + ringOffset, data, size);
+		_bufferRegions.push_back({ buffer, { ringOffset, offset, size } });
+
+		++_stats.uploads;
+		_stats.bytes += size;
+		return true;
+	}
+
+	bool UploadManager::upload(VkImage image, const VkImageSubresourceLayers& subresource, VkOffset3D offset, VkExtent3D extent,
+		const void* data, VkDeviceSize size, VkImageLayout oldLayout, VkImageLayout newLayout)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		// buffer offsets of image copies must be a multiple of 4 and of the texel size, 48 is one for every format up to 16 byte texels
+		VkDeviceSize ringOffset;
+		if (!reserve(size, 48, ringOffset))
+			return false;
+
+		std::memcpy(static_cast<char*>(_memory.mapped) + ringOffset, data, size);
+
+		ImageRegion region = { image, oldLayout, newLayout, {} };
+		region.copy.bufferOffset = ringOffset;
+		region.copy.imageSubresource = subresource;
+		region.copy.imageOffset = offset;
+		region.copy.imageExtent = extent;
+		_imageRegions.push_back(region);
+
+		++_stats.uploads;
+		_stats.bytes += size;
+		return true;
+	}
+
+	void UploadManager::retire(uint32_t slot)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		// frames complete in order, everything written before this slot's flush has been consumed
+		_tail = std::max(_tail, _frameHeads[slot]);
+	}
+
+	bool UploadManager::flush(VkCommandBuffer commandBuffer, uint32_t slot)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_frameHeads[slot] = _head;
+		if (_bufferRegions.empty() && _imageRegions.empty())
+			return false;
+
+		// one copy command per destination, in upload order within it so later uploads win on overlap
+		std::stable_sort(_bufferRegions.begin(), _bufferRegions.end(), [](const BufferRegion& a, const BufferRegion& b) {
+			return a.buffer < b.buffer;
+		});
+		std::stable_sort(_imageRegions.begin(), _imageRegions.end(), [](const ImageRegion& a, const ImageRegion& b) {
+			return a.image < b.image;
+		});
+
+		const bool ownershipTransfer = _queueFamily != _ownerFamily;
+		const uint32_t srcFamily = ownershipTransfer ? _queueFamily : VK_QUEUE_FAMILY_IGNORED;
+		const uint32_t dstFamily = ownershipTransfer ? _ownerFamily : VK_QUEUE_FAMILY_IGNORED;
+
+		// images need to be in transfer layout, on the same queue earlier frames may also still read the destinations
+		VkPipelineStageFlags srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		if (!ownershipTransfer)
+			srcStages |= CONSUMER_STAGES;
+
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		for (size_t i = 0; i < _imageRegions.size(); ++i) {
+			const ImageRegion& region = _imageRegions[i];
+			if (i && region.image == _imageRegions[i - 1].image)
+				continue;
+
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.oldLayout = region.oldLayout;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = region.image;
+			barrier.subresourceRange = { region.copy.imageSubresource.aspectMask, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+			imageBarriers.push_back(barrier);
+		}
+
+		vkCmdPipelineBarrier(commandBuffer, srcStages, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+		std::vector<VkBufferCopy> bufferCopies;
+		for (size_t i = 0; i < _bufferRegions.size(); ++i) {
+			bufferCopies.push_back(_bufferRegions[i].copy);
+			if (i + 1 == _bufferRegions.size() || _bufferRegions[i + 1].buffer != _bufferRegions[i].buffer) {
+				vkCmdCopyBuffer(commandBuffer, _buffer, _bufferRegions[i].buffer, static_cast<uint32_t>(bufferCopies.size()), bufferCopies.data());
+				bufferCopies.clear();
+				++_stats.copyCommands;
+			}
+		}
+
+		std::vector<VkBufferImageCopy> imageCopies;
+		for (size_t i = 0; i < _imageRegions.size(); ++i) {
+			imageCopies.push_back(_imageRegions[i].copy);
+			if (i + 1 == _imageRegions.size() || _imageRegions[i + 1].image != _imageRegions[i].image) {
+				vkCmdCopyBufferToImage(commandBuffer, _buffer, _imageRegions[i].image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					static_cast<uint32_t>(imageCopies.size()), imageCopies.data());
+				imageCopies.clear();
+				++_stats.copyCommands;
+			}
+		}
+
+		for (auto& barrier : imageBarriers) {
+			const auto region = std::find_if(_imageRegions.begin(), _imageRegions.end(), [&barrier](const ImageRegion& region) {
+				return region.image == barrier.image;
+			});
+
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = ownershipTransfer ? 0 : VK_ACCESS_SHADER_READ_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = region->newLayout;
+			barrier.srcQueueFamilyIndex = srcFamily;
+			barrier.dstQueueFamilyIndex = dstFamily;
+		}
+
+		if (!ownershipTransfer) {
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = CONSUMER_ACCESS;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, CONSUMER_STAGES, 0,
+				1, &memoryBarrier, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+		}
+		else {
+			// only the written ranges change owner, contiguous uploads to a buffer share one barrier
+			std::vector<VkBufferMemoryBarrier> bufferBarriers;
+			std::vector<BufferRegion> ranges = _bufferRegions;
+			std::sort(ranges.begin(), ranges.end(), [](const BufferRegion& a, const BufferRegion& b) {
+				return a.buffer < b.buffer || (a.buffer == b.buffer && a.copy.dstOffset < b.copy.dstOffset);
+			});
+
+			for (const auto& range : ranges) {
+				if (!bufferBarriers.empty() && bufferBarriers.back().buffer == range.buffer
+					&& bufferBarriers.back().offset + bufferBarriers.back().size >= range.copy.dstOffset) {
+					VkBufferMemoryBarrier& barrier = bufferBarriers.back();
+					barrier.size = std::max(barrier.offset + barrier.size, range.copy.dstOffset + range.copy.size) - barrier.offset;
+					continue;
+				}
+
+				VkBufferMemoryBarrier barrier = {};
+				barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = 0;
+				barrier.srcQueueFamilyIndex = srcFamily;
+				barrier.dstQueueFamilyIndex = dstFamily;
+				barrier.buffer = range.buffer;
+				barrier.offset = range.copy.dstOffset;
+				barrier.size = range.copy.size;
+				bufferBarriers.push_back(barrier);
+			}
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+				0, nullptr, static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+				static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+			// the owner records the matching acquire, the access masks only matter on its side
+			for (auto& barrier : bufferBarriers) {
+				barrier.srcAccessMask = 0;
+				barrier.dstAccessMask = CONSUMER_ACCESS;
+			}
+			for (auto& barrier : imageBarriers) {
+				barrier.srcAccessMask = 0;
+				barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			}
+
+			_acquireBufferBarriers.insert(_acquireBufferBarriers.end(), bufferBarriers.begin(), bufferBarriers.end());
+			_acquireImageBarriers.insert(_acquireImageBarriers.end(), imageBarriers.begin(), imageBarriers.end());
+		}
+
+		++_stats.batches;
+		_bufferRegions.clear();
+		_imageRegions.clear();
+		return true;
+	}
+
+	void UploadManager::acquire(VkCommandBuffer commandBuffer)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (_acquireBufferBarriers.empty() && _acquireImageBarriers.empty())
+			return;
+
+		// the semaphore wait of the owner's submit blocks the consumer stages, the barrier chains on them
+		vkCmdPipelineBarrier(commandBuffer, CONSUMER_STAGES, CONSUMER_STAGES, 0,
+			0, nullptr, static_cast<uint32_t>(_acquireBufferBarriers.size()), _acquireBufferBarriers.data(),
+			static_cast<uint32_t>(_acquireImageBarriers.size()), _acquireImageBarriers.data());
+
+		_acquireBufferBarriers.clear();
+		_acquireImageBarriers.clear();
+	}
+
+	UploadManager::Stats UploadManager::stats()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _stats;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <mutex>
+
+#include "NonCopyable.h"
+#include "MemoryAllocator.h"
+
+namespace core
+{
+	// Streams buffer and image data to the GPU through one persistently mapped ring buffer.
+	// upload() only copies into the ring and queues a region, flush() records every queued
+	// region of the frame with one copy command per destination, so thousands of small uploads
+	// cost neither an allocation nor a submit each. The ring space of a frame is given back
+	// by retire() once that frame's fence has signaled.
+	// The copies can run on a queue of another family than the one consuming the data: flush()
+	// then releases the written ranges and acquire() records the matching acquire for the owner.
+	// Cross family uploads are meant for data no frame in flight still reads, the copy queue
+	// does not wait on the owner before overwriting.
+	class UploadManager : public util::NonCopyable
+	{
+	public:
+		static constexpr VkDeviceSize DEFAULT_RING_SIZE = 32ull * 1024 * 1024;
+
+		struct Stats {
+			uint64_t uploads = 0;
+			uint64_t bytes = 0;
+			uint64_t batches = 0;
+			uint64_t copyCommands = 0;
+			uint64_t rejected = 0;
+			VkDeviceSize peakUsage = 0;
+		};
+
+		UploadManager() = default;
+		~UploadManager() = default;
+
+		// the owner also needs to wait on the copies with CONSUMER_STAGES when the families differ
+		static constexpr VkPipelineStageFlags CONSUMER_STAGES = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+			| VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		static constexpr VkAccessFlags CONSUMER_ACCESS = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+			| VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+		void init(VkDevice device, MemoryAllocator& allocator, uint32_t slotCount,
+			uint32_t queueFamily, uint32_t ownerFamily, VkDeviceSize ringSize = DEFAULT_RING_SIZE);
+		void clean();
+
+		// return false without queuing anything when the ring has no room left, the upload can be retried next frame
+		bool upload(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+		bool upload(VkImage image, const VkImageSubresourceLayers& subresource, VkOffset3D offset, VkExtent3D extent,
+			const void* data, VkDeviceSize size, VkImageLayout oldLayout, VkImageLayout newLayout);
+
+		void retire(uint32_t slot);
+		// returns whether anything was recorded
+		bool flush(VkCommandBuffer commandBuffer, uint32_t slot);
+		void acquire(VkCommandBuffer commandBuffer);
+
+		Stats stats();
+
+	private:
+		struct BufferRegion {
+			VkBuffer buffer;
+			VkBufferCopy copy;
+		};
+
+		struct ImageRegion {
+			VkImage image;
+			VkImageLayout oldLayout;
+			VkImageLayout newLayout;
+			VkBufferImageCopy copy;
+		};
+
+		VkDevice _device = VK_NULL_HANDLE;
+		MemoryAllocator* _allocator = nullptr;
+		VkBuffer _buffer;
+		MemoryAllocator::Allocation _memory;
+		VkDeviceSize _size;
+		uint32_t _queueFamily;
+		uint32_t _ownerFamily;
+
+		// positions grow forever, the ring offset is position % size
+		uint64_t _head = 0;
+		uint64_t _tail = 0;
+		std::vector<uint64_t> _frameHeads;
+
+		std::vector<BufferRegion> _bufferRegions;
+		std::vector<ImageRegion> _imageRegions;
+		std::vector<VkBufferMemoryBarrier> _acquireBufferBarriers;
+		std::vector<VkImageMemoryBarrier> _acquireImageBarriers;
+		Stats _stats;
+		std::mutex _mutex;
+
+		bool reserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <vector>
+#include <cstring>
+
+namespace core
+{
+	enum class VertexLayout {
+		Interleaved,	// one binding, attributes next to each other
+		Deinterleaved	// one tightly packed binding per attribute, passes can bind only the streams they read
+	};
+
+	template<typename T, VkFormat FORMAT>
+	struct VertexAttribute {
+		typedef T Type;
+		static constexpr VkFormat format = FORMAT;
+		static constexpr uint32_t size = sizeof(T);
+	};
+
+	// What pipelines and meshes need to know about a format at run time. Streams of a deinterleaved
+	// mesh follow each other, stream i starts at vertexCount * streamOffsets[i].
+	struct VertexInputDescription {
+		VertexLayout layout;
+		uint32_t vertexSize;
+		std::vector<VkVertexInputBindingDescription> bindings;
+		std::vector<VkVertexInputAttributeDescription> attributes;
+		std::vector<uint32_t> streamOffsets;
+	};
+
+	// Compile-time vertex format: attribute i is read at location i, offsets and stride are
+	// derived from the attribute types so the CPU vertex struct and the pipeline can not drift.
+	template<typename... Attributes>
+	struct VertexFormat
+	{
+		static constexpr uint32_t attributeCount = sizeof...(Attributes);
+		static constexpr uint32_t stride = (Attributes::size + ...);
+		static constexpr std::array<VkFormat, attributeCount> formats = { Attributes::format... };
+		static constexpr std::array<uint32_t, attributeCount> sizes = { Attributes::size... };
+		static constexpr std::array<uint32_t, attributeCount> offsets = [] {
+			std::array<uint32_t, attributeCount> offsets = {};
+			uint32_t offset = 0;
+			for (uint32_t i = 0; i < attributeCount; ++i) {
+				offsets[i] = offset;
+				offset += sizes[i];
+			}
+			return offsets;
+		}();
+
+		static VertexInputDescription description(VertexLayout layout)
+		{
+			VertexInputDescription description;
+			description.layout = layout;
+			description.vertexSize = stride;
+
+			for (uint32_t i = 0; i < attributeCount; ++i) {
+				const bool interleaved = layout == VertexLayout::Interleaved;
+				if (!interleaved || !i) {
+					description.bindings.push_back({ i, interleaved ? stride : sizes[i], VK_VERTEX_INPUT_RATE_VERTEX });
+					description.streamOffsets.push_back(interleaved ? 0 : offsets[i]);
+				}
+
+				description.attributes.push_back({ i, interleaved ? 0 : i, formats[i], interleaved ? offsets[i] : 0 });
+			}
+
+			return description;
+		}
+
+		// splits interleaved vertices into the streams of the deinterleaved layout
+		static void deinterleave(const void* vertices, size_t vertexCount, void* streams)
+		{
+			const char* source = static_cast<const char*>(vertices);
+			char* destination = static_cast<char*>(streams);
+
+			for (uint32_t i = 0; i < attributeCount; ++i) {
+				char* stream = destination + vertexCount * offsets[i];
+				for (size_t v = 0; v < vertexCount; ++v)
+					std::memcpy(stream + v * sizes[i], source + v * stride + offsets[i], sizes[i]);
+			}
+		}
+	};
+}
\ No newline at end of file
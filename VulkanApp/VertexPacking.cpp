@@ -0,0 +1,82 @@
+#include "VertexPacking.h"
+
+#include <glm/packing.hpp>
+#include <glm/gtc/packing.hpp>
+
+namespace core
+{
+	namespace VertexPacking
+	{
+		namespace
+		{
+			glm::vec2 signNotZero(const glm::vec2& v)
+			{
+				return glm::vec2(v.x >= 0.f ? 1.f : -1.f, v.y >= 0.f ? 1.f : -1.f);
+			}
+		}
+
+		glm::u16vec4 packPosition(const glm::vec3& position)
+		{
+			return glm::packHalf(glm::vec4(position, 1.f));
+		}
+
+		glm::vec3 unpackPosition(const glm::u16vec4& packed)
+		{
+			return glm::vec3(glm::unpackHalf(packed));
+		}
+
+		uint32_t packNormal(const glm::vec3& normal)
+		{
+			// project on the octahedron, then fold the lower half over the diagonals
+			glm::vec2 p = glm::vec2(normal) / (glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z));
+			if (normal.z < 0.f)
+				p = (1.f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p);
+
+			return glm::packSnorm2x16(p);
+		}
+
+		glm::vec3 unpackNormal(uint32_t packed)
+		{
+			const glm::vec2 p = glm::unpackSnorm2x16(packed);
+
+			glm::vec3 normal(p, 1.f - glm::abs(p.x) - glm::abs(p.y));
+			if (normal.z < 0.f) {
+				const glm::vec2 folded = (1.f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p);
+				normal.x = folded.x;
+				normal.y = folded.y;
+			}
+
+			return glm::normalize(normal);
+		}
+
+		uint32_t packTexCoord(const glm::vec2& texCoord)
+		{
+			return glm::packHalf2x16(texCoord);
+		}
+
+		glm::vec2 unpackTexCoord(uint32_t packed)
+		{
+			return glm::unpackHalf2x16(packed);
+		}
+
+		uint32_t packTangent(const glm::vec4& tangent)
+		{
+			return glm::packUnorm3x10_1x2(glm::vec4(glm::vec3(tangent) * .5f + .5f, tangent.w < 0.f ? 0.f : 1.f));
+		}
+
+		glm::vec4 unpackTangent(uint32_t packed)
+		{
+			return glm::unpackUnorm3x10_1x2(packed) * 2.f - 1.f;
+		}
+
+		uint32_t packColor(const glm::vec4& color)
+		{
+			return glm::packUnorm4x8(color);
+		}
+
+		glm::vec4 unpackColor(uint32_t packed)
+		{
+			return glm::unpackUnorm4x8(packed);
+		}
+	}
+}
\ No newline at end of file
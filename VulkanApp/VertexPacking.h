@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstdint>
+
+namespace core
+{
+	// Encoders for compressed vertex attributes on top of glm's packing functions. Each one names the
+	// VkFormat to read the result with and the worst case error over its input domain. The decoders
+	// mirror what the vertex input unit and the shader do and exist to check those bounds.
+	namespace VertexPacking
+	{
+		// VK_FORMAT_R16G16B16A16_SFLOAT, w = 1: relative error 2^-11 per component
+		glm::u16vec4 packPosition(const glm::vec3& position);
+		glm::vec3 unpackPosition(const glm::u16vec4& packed);
+
+		// VK_FORMAT_R16G16_SNORM, octahedral mapping of a unit vector: below 0.005 degrees.
+		// Decode in the shader: n = vec3(p, 1 - |p.x| - |p.y|); if (n.z < 0) n.xy = (1 - abs(n.yx)) * (n.xy >= 0 ? 1 : -1); normalize(n)
+		uint32_t packNormal(const glm::vec3& normal);
+		glm::vec3 unpackNormal(uint32_t packed);
+
+		// VK_FORMAT_R16G16_SFLOAT: relative error 2^-11, below 2^-12 for coordinates in [0, 1], tiled coordinates lose precision as they grow
+		uint32_t packTexCoord(const glm::vec2& texCoord);
+		glm::vec2 unpackTexCoord(uint32_t packed);
+
+		// VK_FORMAT_A2B10G10R10_UNORM_PACK32, snorm 10:10:10:2 vertex input is not supported everywhere: xyz biased
+		// to [0, 1] (decode xyz * 2 - 1, error 1/1023), bitangent sign w in the 2 bit alpha (decode a * 2 - 1)
+		uint32_t packTangent(const glm::vec4& tangent);
+		glm::vec4 unpackTangent(uint32_t packed);
+
+		// VK_FORMAT_R8G8B8A8_UNORM: 1/510 error per channel
+		uint32_t packColor(const glm::vec4& color);
+		glm::vec4 unpackColor(uint32_t packed);
+	}
+}
\ No newline at end of file
@@ -1,10 +1,167 @@
 #include "App.h"
+#include "Benchmarks.h"
 #include "Singleton.h"
 
-int main()
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <stdexcept>
+
+int main(int argc, char** argv)
 {
+	core::App::Settings settings;
+	std::vector<core::App::MeshConversion> conversions;
+	uint jobBenchmark = 0;
+	uint allocatorBenchmark = 0;
+	uint packingCheck = 0;
+	uint optimizerCheck = 0;
+	uint meshletCheck = 0;
+	uint cullBenchmark = 0;
+	uint bvhBenchmark = 0;
+	uint sceneBenchmark = 0;
+	uint transformBenchmark = 0;
+	uint renderQueueBenchmark = 0;
+
+	int i = 1;
+	// the value of the option at i, which is then skipped
+	const auto value = [&]() -> const char* {
+		if (i + 1 == argc)
+			throw std::invalid_argument(std::string("missing value for ") + argv[i]);
+		return argv[++i];
+	};
+	// std::stoul would take "-1" and wrap it and ignore trailing characters, so the whole value is checked before narrowing
+	const auto count = [&]() -> uint {
+		const char* text = value();
+		char* end = nullptr;
+		errno = 0;
+		const unsigned long long parsed = std::strtoull(text, &end, 10);
+		if (end == text || *end || errno == ERANGE || std::strchr(text, '-') || parsed > std::numeric_limits<uint>::max())
+			throw std::invalid_argument(std::string("invalid value for ") + argv[i - 1] + ": " + text);
+		return static_cast<uint>(parsed);
+	};
+	const auto real = [&]() -> float {
+		const char* text = value();
+		char* end = nullptr;
+		errno = 0;
+		const float parsed = std::strtof(text, &end);
+		if (end == text || *end || errno == ERANGE || !std::isfinite(parsed))
+			throw std::invalid_argument(std::string("invalid value for ") + argv[i - 1] + ": " + text);
+		return parsed;
+	};
+
+	try {
+		for (; i < argc; ++i) {
+			if (!std::strcmp(argv[i], "--headless"))
+				settings.headless = true;
+			else if (!std::strcmp(argv[i], "--readback"))
+				settings.readback = true;
+			else if (!std::strcmp(argv[i], "--no-transfer-queue"))
+				settings.transferQueue = false;
+			else if (!std::strcmp(argv[i], "--exclusive-swapchain"))
+				settings.exclusiveSwapchain = true;
+			else if (!std::strcmp(argv[i], "--deinterleaved"))
+				settings.vertexLayout = core::VertexLayout::Deinterleaved;
+			else if (!std::strcmp(argv[i], "--quantized"))
+				settings.quantizedVertices = true;
+			else if (!std::strcmp(argv[i], "--mesh-file-read"))
+				settings.meshFileRead = true;
+			else if (!std::strcmp(argv[i], "--no-optimize"))
+				settings.optimizeMeshes = false;
+			else if (!std::strcmp(argv[i], "--cluster-culling"))
+				settings.clusterCulling = true;
+			else if (!std::strcmp(argv[i], "--gpu-driven"))
+				settings.gpuDriven = true;
+			else if (!std::strcmp(argv[i], "--cpu-culling"))
+				settings.cpuCulling = true;
+			else if (!std::strcmp(argv[i], "--width"))
+				settings.width = count();
+			else if (!std::strcmp(argv[i], "--height"))
+				settings.height = count();
+			else if (!std::strcmp(argv[i], "--frames-in-flight"))
+				settings.framesInFlight = count();
+			else if (!std::strcmp(argv[i], "--frames"))
+				settings.frameCount = count();
+			else if (!std::strcmp(argv[i], "--draws"))
+				settings.drawCount = count();
+			else if (!std::strcmp(argv[i], "--trace"))
+				settings.tracePath = value();
+			else if (!std::strcmp(argv[i], "--threads"))
+				settings.workerThreads = count();
+			else if (!std::strcmp(argv[i], "--uploads"))
+				settings.uploadCount = count();
+			else if (!std::strcmp(argv[i], "--mesh"))
+				settings.meshSize = count();
+			else if (!std::strcmp(argv[i], "--mesh-file"))
+				settings.meshFile = value();
+			else if (!std::strcmp(argv[i], "--spread"))
+				settings.objectSpread = real();
+			else if (!std::strcmp(argv[i], "--job-benchmark"))
+				jobBenchmark = count();
+			else if (!std::strcmp(argv[i], "--allocator-benchmark"))
+				allocatorBenchmark = count();
+			else if (!std::strcmp(argv[i], "--packing-check"))
+				packingCheck = count();
+			else if (!std::strcmp(argv[i], "--optimizer-check"))
+				optimizerCheck = count();
+			else if (!std::strcmp(argv[i], "--meshlet-check"))
+				meshletCheck = count();
+			else if (!std::strcmp(argv[i], "--cull-benchmark"))
+				cullBenchmark = count();
+			else if (!std::strcmp(argv[i], "--bvh-benchmark"))
+				bvhBenchmark = count();
+			else if (!std::strcmp(argv[i], "--scene-benchmark"))
+				sceneBenchmark = count();
+			else if (!std::strcmp(argv[i], "--transform-benchmark"))
+				transformBenchmark = count();
+			else if (!std::strcmp(argv[i], "--render-queue-benchmark"))
+				renderQueueBenchmark = count();
+			else if (!std::strcmp(argv[i], "--convert")) {
+				if (i + 2 >= argc)
+					throw std::invalid_argument("--convert needs an input and an output path");
+				conversions.push_back({ argv[i + 1], argv[i + 2] });
+				i += 2;
+			}
+			else
+				throw std::invalid_argument(std::string("unknown option ") + argv[i]);
+		}
+	}
+	catch (const std::invalid_argument& e) {
+		// printed even in release builds, where LOG is compiled out
+		REPORT(e.what())
+		return EXIT_FAILURE;
+	}
+
+	// offline conversion only, the vertex format options given with it select the output format
+	if (!conversions.empty())
+		return core::App::convertMeshes(conversions, settings) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	// CPU microbenchmarks, each checks its results against a plain reference
+	if (jobBenchmark)
+		return core::Benchmarks::jobs(jobBenchmark, settings) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (allocatorBenchmark)
+		return core::Benchmarks::allocator(allocatorBenchmark) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (packingCheck)
+		return core::Benchmarks::vertexPacking(packingCheck) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (optimizerCheck)
+		return core::Benchmarks::meshOptimizer(optimizerCheck, settings) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (meshletCheck)
+		return core::Benchmarks::meshlets(meshletCheck) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (cullBenchmark)
+		return core::Benchmarks::culling(cullBenchmark, settings) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (bvhBenchmark)
+		return core::Benchmarks::bvh(bvhBenchmark, settings) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (sceneBenchmark)
+		return core::Benchmarks::scene(sceneBenchmark, settings) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (transformBenchmark)
+		return core::Benchmarks::transforms(transformBenchmark, settings) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (renderQueueBenchmark)
+		return core::Benchmarks::renderQueue(renderQueueBenchmark, settings) ? EXIT_SUCCESS : EXIT_FAILURE;
+
 	try {
-		util::Singleton<core::App>::instance().run();
+		util::Singleton<core::App>::instance().run(settings);
 	}
 	catch (const std::runtime_error& e) {
 		LOG(LogError, e.what());
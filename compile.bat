@@ -1,3 +1,5 @@
 call %cd%\glslangValidator.exe -V VulkanApp\VertexShader.vert
 call %cd%\glslangValidator.exe -V VulkanApp\FragmentShader.frag
+call %cd%\glslangValidator.exe -V VulkanApp\ClusterCulling.comp -o cluster.spv
+call %cd%\glslangValidator.exe -V VulkanApp\ObjectCulling.comp -o objects.spv
 exit 0
\ No newline at end of file